@@ -0,0 +1,225 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+#include "init.h"
+#include "utils.h"
+#include "powerlossemu.h"
+#include "loopback.h"
+#include "bench.h"
+
+// Timer1 runs at 12 MHz, 18 counts is 1.5 us
+#define BENCH_GAP_CYCLES_PER_US (18)
+
+typedef struct benchStep
+{
+    uint32_t            pulses;
+    uint16_t            gaps;
+    uint16_t            overruns;
+    uint16_t            worstLatency;   // Timer3 ticks
+    uint16_t            worstGap;       // Timer1 cycles
+    bool                finished;
+} benchStep_t;
+
+volatile bool benchActive;
+
+static const char *const loadNames[NUM_BENCH_LOADS] =
+{
+    "Idle    ",
+    "Console ",
+    "Loopback",
+};
+
+// Interrupt state
+static uint16_t gapLimitCycles;
+static uint16_t lastMatchCycles;
+static volatile uint16_t gaps;
+static volatile uint16_t overruns;
+static volatile uint16_t worstGap;
+
+static bool Bench_RunStep(uint16_t period, benchLoad_e load, benchStep_t *step)
+{
+    uint32_t startPulses;
+    uint32_t startTime;
+    uint32_t timeout;
+    uint32_t pulses;
+
+    Util_SetNewCompareValue(0);
+    INTCONbits.GIEH = 0;
+    gapLimitCycles = period * BENCH_GAP_CYCLES_PER_US;
+    gaps = 0;
+    overruns = 0;
+    worstGap = 0;
+    pulseLatencyWorst = 0;
+    INTCONbits.GIEH = 1;
+    if (load == BENCH_LOAD_LOOPBACK)
+    {
+        Loopback_Start();
+    }
+    startPulses = Util_GetPulseCount();
+    // Give up at four times as long as it should take
+    timeout = 4 * BENCH_STEP_PULSES * period;
+    startTime = Util_GetMicrosecondUptime();
+    lastMatchCycles = TMR1;
+    benchActive = true;
+    Util_SetNewCompareValue(period);
+    do
+    {
+        pulses = Util_GetPulseCount() - startPulses;
+        if (load != BENCH_LOAD_IDLE)
+        {
+            Console_PrintNoEol("\r%5u us %6lu pulses", period, pulses);
+        }
+        if (load == BENCH_LOAD_LOOPBACK)
+        {
+            Loopback_Service();
+        }
+    }
+    while ((pulses < BENCH_STEP_PULSES) && ((Util_GetMicrosecondUptime() - startTime) < timeout));
+    Util_SetNewCompareValue(0);
+    benchActive = false;
+    if (load == BENCH_LOAD_LOOPBACK)
+    {
+        Loopback_Stop();
+    }
+
+    step->pulses = Util_GetPulseCount() - startPulses;
+    step->finished = (step->pulses >= BENCH_STEP_PULSES);
+    INTCONbits.GIEH = 0;
+    step->gaps = gaps;
+    step->overruns = overruns;
+    step->worstGap = worstGap;
+    step->worstLatency = pulseLatencyWorst;
+    pulseLatencyWorst = 0;
+    INTCONbits.GIEH = 1;
+
+    return step->finished && (step->gaps == 0) && (step->overruns == 0);
+}
+
+// Returns the shortest period that passed, or 0 if none did
+static uint16_t Bench_Sweep(benchLoad_e load)
+{
+    benchStep_t step;
+    uint16_t period = BENCH_START_PERIOD_US;
+    uint16_t passed = 0;
+    uint16_t decrement;
+    bool ok;
+
+    Console_Print("Load: %s", loadNames[load]);
+    Console_Print("Period   Pulses   Gaps  Overruns  Worst gap  Worst latency");
+    while (period >= BENCH_MIN_PERIOD_US)
+    {
+        ok = Bench_RunStep(period, load, &step);
+        Console_Print("\r%5u us %6lu %6u %9u %7lu us %9lu ns  %s", period, step.pulses, step.gaps, step.overruns,
+                      (uint32_t)step.worstGap / 12, ((uint32_t)step.worstLatency * 2000) / 3,
+                      ok ? ANSI_COLOR_GREEN"ok"ANSI_COLOR_RESET : ANSI_COLOR_RED"FAIL"ANSI_COLOR_RESET);
+        if (!ok)
+        {
+            break;
+        }
+        passed = period;
+        decrement = period / 10;
+        period -= (decrement == 0) ? 1 : decrement;
+    }
+
+    return passed;
+}
+
+// Called at the end of the ECCP1 branch on every match while benchmarking
+void Bench_CompareIsr(void)
+{
+    uint16_t now = TMR1;
+    uint16_t gap = now - lastMatchCycles;
+
+    lastMatchCycles = now;
+    if (gap > gapLimitCycles)
+    {
+        gaps++;
+    }
+    if (gap > worstGap)
+    {
+        worstGap = gap;
+    }
+    // The next match already came in while this one was being handled
+    if (PIR1bits.CCP1IF)
+    {
+        overruns++;
+    }
+}
+
+functionResult_e Bench_Run(unsigned int numArgs, int args[])
+{
+    uint16_t results[NUM_BENCH_LOADS] = {0};
+    unsigned int load;
+    uint8_t first;
+    uint8_t last;
+
+    // The sweep needs the comparator to itself
+    if (PowerLossEmu_IsRunning())
+    {
+        Console_Print(ANSI_COLOR_RED" Stop the running workload first!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+
+    // Arguments: load
+    Console_Print("Loads: [0]-idle [1]-console [2]-console and loopback (jumper RB0 to RB3) [3]-all");
+    load = Console_ArgOrPromptForInt(numArgs, args, 0, "Enter load: ");
+    if (load > NUM_BENCH_LOADS)
+    {
+        Console_Print(ANSI_COLOR_RED"Invalid load!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+    first = (load == NUM_BENCH_LOADS) ? 0 : load;
+    last = (load == NUM_BENCH_LOADS) ? (NUM_BENCH_LOADS - 1) : load;
+
+    // Timer1 is the reference for gaps, it's only running already when
+    // profiling is compiled in
+    Init_Timer1();
+    Console_Print("Benchmarking, %lu pulses per step, RB0 will pulse...", BENCH_STEP_PULSES);
+    Console_PrintDivider();
+    for (uint8_t i = first; i <= last; i++)
+    {
+        results[i] = Bench_Sweep((benchLoad_e)i);
+        Console_PrintDivider();
+    }
+
+    Console_Print("Shortest reliable period:");
+    for (uint8_t i = first; i <= last; i++)
+    {
+        if (results[i] == 0)
+        {
+            Console_Print("%s     none, failed at %d us", loadNames[i], BENCH_START_PERIOD_US);
+        }
+        else
+        {
+            Console_Print("%s %5u us (%lu Hz)", loadNames[i], results[i], MICROSECONDS_IN_SECONDS / results[i]);
+        }
+    }
+
+    return SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+
+// Finds the shortest period the compare interrupt can keep up with. The
+// period is stepped down by about 10% at a time from BENCH_START_PERIOD_US
+// and each step runs BENCH_STEP_PULSES pulses. A step fails if a match came
+// in while the one before was still being handled (CCP1IF set again before
+// the ECCP1 branch is done) or if two pulses are more than 1.5 periods apart
+// going by Timer1. Rerun after firmware changes and compare the results.
+#define BENCH_START_PERIOD_US   (200)
+// Below this the main loop barely gets to run between interrupts
+#define BENCH_MIN_PERIOD_US     (10)
+#define BENCH_STEP_PULSES       (5000UL)
+
+typedef enum
+{
+    BENCH_LOAD_IDLE = 0,        // Main loop only polls
+    BENCH_LOAD_CONSOLE,         // Main loop keeps printing a status line
+    BENCH_LOAD_LOOPBACK,        // As above plus an ECCP2 capture per pulse
+    NUM_BENCH_LOADS
+} benchLoad_e;
+
+extern volatile bool benchActive;
+
+void Bench_CompareIsr(void);
+functionResult_e Bench_Run(unsigned int numArgs, int args[]);
+
+#endif // BENCH_H
\ No newline at end of file
@@ -0,0 +1,260 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+#include "utils.h"
+#include "powerlossemu.h"
+#include "brownout.h"
+
+typedef enum
+{
+    BROWNOUT_PHASE_DOWN = 0,
+    BROWNOUT_PHASE_HOLD,
+    BROWNOUT_PHASE_UP,
+    BROWNOUT_PHASE_REST,
+    NUM_BROWNOUT_PHASES,
+} brownoutPhase_e;
+
+typedef struct brownoutPhase
+{
+    uint16_t            steps;
+    uint16_t            interval;   // Timer2 ticks per step
+    bool                ramp;       // Steps through the duty table
+} brownoutPhase_t;
+
+volatile bool brownoutActive;
+
+static brownoutSettings_t brownoutSettings;
+
+// Ramp down then ramp up, worked out whenever the settings change so the
+// tick interrupt only ever copies values out
+static uint16_t dutyTable[2 * BROWNOUT_RAMP_STEPS];
+static brownoutPhase_t phases[NUM_BROWNOUT_PHASES];
+
+// Interrupt state
+static bool repeating;
+static uint8_t phase;
+static uint8_t tableIndex;
+static uint16_t stepsLeft;
+static uint16_t ticksLeft;
+
+static void Brownout_SetDuty(uint16_t duty)
+{
+    // Both halves are latched together at the end of the PWM period
+    CCP2CONbits.DC2B = duty & 0x3;
+    CCPR2L = (uint8_t)(duty >> 2);
+}
+
+static uint16_t Brownout_RampInterval(uint16_t rampTime)
+{
+    uint32_t interval = ((uint32_t)rampTime * BROWNOUT_TICKS_PER_MS) / BROWNOUT_RAMP_STEPS;
+
+    // A ramp of zero is as steep as the tick allows
+    return (interval == 0) ? 1 : (uint16_t)interval;
+}
+
+static void Brownout_BuildProfile(void)
+{
+    uint16_t lowDuty = (uint16_t)(((uint32_t)BROWNOUT_FULL_DUTY * (100 - brownoutSettings.depth)) / 100);
+    uint16_t span = BROWNOUT_FULL_DUTY - lowDuty;
+
+    for (uint8_t i = 0; i < BROWNOUT_RAMP_STEPS; i++)
+    {
+        dutyTable[i] = BROWNOUT_FULL_DUTY - (uint16_t)(((uint32_t)span * (i + 1)) / BROWNOUT_RAMP_STEPS);
+        dutyTable[BROWNOUT_RAMP_STEPS + i] = lowDuty + (uint16_t)(((uint32_t)span * (i + 1)) / BROWNOUT_RAMP_STEPS);
+    }
+
+    phases[BROWNOUT_PHASE_DOWN].steps = BROWNOUT_RAMP_STEPS;
+    phases[BROWNOUT_PHASE_DOWN].interval = Brownout_RampInterval(brownoutSettings.rampDown);
+    phases[BROWNOUT_PHASE_DOWN].ramp = true;
+    phases[BROWNOUT_PHASE_HOLD].steps = brownoutSettings.hold;
+    phases[BROWNOUT_PHASE_HOLD].interval = BROWNOUT_TICKS_PER_MS;
+    phases[BROWNOUT_PHASE_HOLD].ramp = false;
+    phases[BROWNOUT_PHASE_UP].steps = BROWNOUT_RAMP_STEPS;
+    phases[BROWNOUT_PHASE_UP].interval = Brownout_RampInterval(brownoutSettings.rampUp);
+    phases[BROWNOUT_PHASE_UP].ramp = true;
+    phases[BROWNOUT_PHASE_REST].steps = brownoutSettings.rest;
+    phases[BROWNOUT_PHASE_REST].interval = BROWNOUT_TICKS_PER_MS;
+    phases[BROWNOUT_PHASE_REST].ramp = false;
+}
+
+// Moves on to the next phase with any steps in it, returns false once the
+// profile is over
+static bool Brownout_NextPhase(void)
+{
+    do
+    {
+        phase++;
+        if (phase >= NUM_BROWNOUT_PHASES)
+        {
+            if (!repeating)
+            {
+                return false;
+            }
+            phase = BROWNOUT_PHASE_DOWN;
+            tableIndex = 0;
+        }
+    }
+    while (phases[phase].steps == 0);
+
+    stepsLeft = phases[phase].steps;
+    ticksLeft = phases[phase].interval;
+
+    return true;
+}
+
+void Brownout_Init(void)
+{
+    brownoutSettings.depth = 30;
+    brownoutSettings.rampDown = 5;
+    brownoutSettings.hold = 20;
+    brownoutSettings.rampUp = 10;
+    brownoutSettings.rest = 1000;
+    brownoutSettings.withWorkloads = false;
+    Brownout_BuildProfile();
+    Brownout_SetDuty(BROWNOUT_FULL_DUTY);
+}
+
+void Brownout_Start(bool repeat)
+{
+    PIE1bits.TMR2IE = 0;
+    repeating = repeat;
+    phase = BROWNOUT_PHASE_DOWN;
+    tableIndex = 0;
+    stepsLeft = phases[phase].steps;
+    ticksLeft = phases[phase].interval;
+    brownoutActive = true;
+    PIE1bits.TMR2IE = 1;
+}
+
+void Brownout_Stop(void)
+{
+    brownoutActive = false;
+    Brownout_SetDuty(BROWNOUT_FULL_DUTY);
+}
+
+bool Brownout_IsLinkedToWorkloads(void)
+{
+    return brownoutSettings.withWorkloads;
+}
+
+// Called from the Timer2 interrupt every 10 us
+void Brownout_TickIsr(void)
+{
+    ticksLeft--;
+    if (ticksLeft != 0)
+    {
+        return;
+    }
+    ticksLeft = phases[phase].interval;
+
+    if (phases[phase].ramp)
+    {
+        Brownout_SetDuty(dutyTable[tableIndex]);
+        tableIndex++;
+    }
+    stepsLeft--;
+    if ((stepsLeft == 0) && !Brownout_NextPhase())
+    {
+        brownoutActive = false;
+    }
+}
+
+functionResult_e Brownout_Setup(unsigned int numArgs, int args[])
+{
+    unsigned int depth;
+
+    // Runs linked to brownouts are driving ECCP2 already, and loopback runs
+    // have it for capture
+    if (PowerLossEmu_IsRunning())
+    {
+        Console_Print(ANSI_COLOR_RED" Stop the running workload first!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+
+    Console_Print("Dip depth:       %6u %%", brownoutSettings.depth);
+    Console_Print("Ramp down:       %6u ms", brownoutSettings.rampDown);
+    Console_Print("Hold:            %6u ms", brownoutSettings.hold);
+    Console_Print("Ramp up:         %6u ms", brownoutSettings.rampUp);
+    Console_Print("Rest:            %6u ms", brownoutSettings.rest);
+    Console_Print("With workloads:  %6s", brownoutSettings.withWorkloads ? "yes" : "no");
+
+    // Arguments: depth rampDown hold rampUp rest withWorkloads
+    depth = Console_ArgOrPromptForInt(numArgs, args, 0, "Enter dip depth (% of supply): ");
+    if (depth > 100)
+    {
+        Console_Print(ANSI_COLOR_RED"Depth can't be more than 100%%!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+    brownoutSettings.depth = (uint8_t)depth;
+    brownoutSettings.rampDown = Console_ArgOrPromptForInt(numArgs, args, 1, "Enter ramp down time (ms): ");
+    brownoutSettings.hold = Console_ArgOrPromptForInt(numArgs, args, 2, "Enter hold time (ms): ");
+    brownoutSettings.rampUp = Console_ArgOrPromptForInt(numArgs, args, 3, "Enter ramp up time (ms): ");
+    if ((brownoutSettings.rampDown > BROWNOUT_MAX_RAMP_MS) || (brownoutSettings.rampUp > BROWNOUT_MAX_RAMP_MS))
+    {
+        Console_Print("Limiting ramps to %u ms", BROWNOUT_MAX_RAMP_MS);
+        if (brownoutSettings.rampDown > BROWNOUT_MAX_RAMP_MS)
+        {
+            brownoutSettings.rampDown = BROWNOUT_MAX_RAMP_MS;
+        }
+        if (brownoutSettings.rampUp > BROWNOUT_MAX_RAMP_MS)
+        {
+            brownoutSettings.rampUp = BROWNOUT_MAX_RAMP_MS;
+        }
+    }
+    brownoutSettings.rest = Console_ArgOrPromptForInt(numArgs, args, 4, "Enter rest between dips during workloads (ms): ");
+    brownoutSettings.withWorkloads = (Console_ArgOrPromptForInt(numArgs, args, 5, "Repeat dips during workloads (0/1): ") != 0);
+
+    // Don't change the tables out from under a dip in progress
+    Brownout_Stop();
+    Brownout_BuildProfile();
+
+    return SUCCESS;
+}
+
+functionResult_e Brownout_Dip(unsigned int numArgs, int args[])
+{
+    if (PowerLossEmu_IsRunning())
+    {
+        Console_Print(ANSI_COLOR_RED" Stop the running workload first!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+
+    Console_Print("Dipping P2A (RC0) by %u%%...", brownoutSettings.depth);
+    Brownout_Start(false);
+    while (brownoutActive)
+    {
+        if (Console_CheckForKey() != 0)
+        {
+            Brownout_Stop();
+        }
+    }
+    Console_Print("Done!");
+
+    return SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef BROWNOUT_H
+#define BROWNOUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+
+// Brownout profiles are played out on ECCP2's PWM output P2A (RC0, RP11)
+// which needs an external RC filter and driver to become a supply voltage.
+// Timer4 runs the PWM at 46.875 kHz with 10 bits of duty cycle, the
+// profile is stepped from the 10 us Timer2 tick.
+#define BROWNOUT_FULL_DUTY          (1023)  // 4 x (PR4 + 1) - 1
+#define BROWNOUT_RAMP_STEPS         (32)    // Duty table entries per ramp
+#define BROWNOUT_TICKS_PER_MS       (100)
+// Longest ramp that keeps the time per table entry in 16 bits
+#define BROWNOUT_MAX_RAMP_MS        ((uint16_t)((65535UL * BROWNOUT_RAMP_STEPS) / BROWNOUT_TICKS_PER_MS))
+
+typedef struct brownoutSettings
+{
+    uint8_t             depth;      // % of the supply lost at the bottom of the dip
+    uint16_t            rampDown;   // ms
+    uint16_t            hold;       // ms
+    uint16_t            rampUp;     // ms
+    uint16_t            rest;       // ms between dips while running with workloads
+    bool                withWorkloads;
+} brownoutSettings_t;
+
+extern volatile bool brownoutActive;
+
+void Brownout_Init(void);
+void Brownout_Start(bool repeat);
+void Brownout_Stop(void);
+bool Brownout_IsLinkedToWorkloads(void);
+void Brownout_TickIsr(void);
+functionResult_e Brownout_Setup(unsigned int numArgs, int args[]);
+functionResult_e Brownout_Dip(unsigned int numArgs, int args[]);
+
+#endif // BROWNOUT_H
\ No newline at end of file
@@ -0,0 +1,204 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "utils.h"
+#include "calibration.h"
+#include "burst.h"
+
+// Ticks below which the last piece of a gap is folded into a full chunk
+#define BURST_MIN_CHUNK_TICKS   ((BURST_MIN_SPACING_US * 3) / 2)
+
+typedef struct burstPlan
+{
+    uint16_t            pulses;
+    uint16_t            gapChunks;      // Matches in the gap that don't pulse
+    uint16_t            lastChunkTicks; // Ends with the first pulse of the next burst
+} burstPlan_t;
+
+volatile bool burstActive;
+
+// Settings for this run
+static uint16_t nominalPulses;
+static uint16_t nominalGap;     // ms
+static uint8_t burstVariation;
+static uint16_t spacingTicks;
+static uint16_t randomState = 0xACE1;
+
+// The next burst is worked out in the main loop and picked up by the
+// interrupt at the end of the current one. If the main loop is late the
+// interrupt just reuses the last plan.
+static burstPlan_t nextPlan;
+static volatile bool planConsumed;
+
+// Interrupt state
+static uint16_t activePulses;
+static uint16_t activeLastChunkTicks;
+static uint16_t pulseInBurst;
+static uint16_t gapChunksLeft;
+static volatile uint16_t burstCount;
+
+static uint16_t Burst_Random(void)
+{
+    // 16-bit xorshift
+    randomState ^= randomState << 7;
+    randomState ^= randomState >> 9;
+    randomState ^= randomState << 8;
+    return randomState;
+}
+
+// Returns value +/- up to variation percent of it
+static uint32_t Burst_Vary(uint16_t value)
+{
+    uint32_t spread = ((uint32_t)value * burstVariation) / 100;
+    uint32_t range = (2 * spread) + 1;
+    uint32_t random = Burst_Random();
+
+    // Scale the random number into 0 to 2 x spread without a 32-bit
+    // modulo, in two halves so the multiply can't overflow
+    return value - spread + ((range >> 16) * random) + (((range & 0xFFFF) * random) >> 16);
+}
+
+static void Burst_PlanNext(burstPlan_t *plan)
+{
+    uint32_t pulses = Burst_Vary(nominalPulses);
+    uint32_t gapTicks = Burst_Vary(nominalGap) * ((MICROSECONDS_IN_MILLISECONDS * 3) / 2);
+
+    plan->pulses = (pulses == 0) ? 1 : (uint16_t)pulses;
+    // Never let a gap get shorter than the spacing inside a burst
+    if (gapTicks < spacingTicks)
+    {
+        gapTicks = spacingTicks;
+    }
+    plan->gapChunks = (uint16_t)((gapTicks - 1) / BURST_GAP_CHUNK_TICKS);
+    plan->lastChunkTicks = (uint16_t)(gapTicks - ((uint32_t)plan->gapChunks * BURST_GAP_CHUNK_TICKS));
+    // A sliver at the end could match before the interrupt is done with
+    // the chunk before it
+    if ((plan->lastChunkTicks < BURST_MIN_CHUNK_TICKS) && (plan->gapChunks != 0))
+    {
+        plan->gapChunks--;
+        plan->lastChunkTicks += BURST_GAP_CHUNK_TICKS;
+    }
+}
+
+// Returns the period to start the comparator with, the first burst starts
+// one spacing in
+uint16_t Burst_Start(uint16_t pulsesPerBurst, uint16_t spacing, uint16_t gap, uint8_t variation)
+{
+    burstPlan_t firstPlan;
+
+    if (spacing < BURST_MIN_SPACING_US)
+    {
+        spacing = BURST_MIN_SPACING_US;
+    }
+    nominalPulses = (pulsesPerBurst == 0) ? 1 : pulsesPerBurst;
+    nominalGap = gap;
+    burstVariation = (variation > 100) ? 100 : variation;
+    spacingTicks = Calibration_PeriodToTicks(spacing);
+
+    Burst_PlanNext(&firstPlan);
+    activePulses = firstPlan.pulses;
+    Burst_PlanNext(&nextPlan);
+    planConsumed = false;
+    pulseInBurst = 0;
+    gapChunksLeft = 0;
+    burstCount = 0;
+    burstActive = true;
+
+    return spacing;
+}
+
+void Burst_Stop(void)
+{
+    burstActive = false;
+}
+
+void Burst_Service(void)
+{
+    bool interruptEnabled;
+    burstPlan_t plan;
+
+    if (!planConsumed)
+    {
+        return;
+    }
+    Burst_PlanNext(&plan);
+    // Same as staging a compare value, leave it off if it was off
+    interruptEnabled = PIE1bits.CCP1IE;
+    PIE1bits.CCP1IE = 0;
+    nextPlan = plan;
+    planConsumed = false;
+    PIE1bits.CCP1IE = interruptEnabled;
+}
+
+// Called on every ECCP1 match while a burst workload runs. TMR3 was just
+// reset so CCPR1 is loaded with the length of the period now starting
+// before anything else. Returns whether this match should pulse.
+bool Burst_CompareIsr(void)
+{
+    // In a gap, only the last piece ends with a pulse
+    if (gapChunksLeft != 0)
+    {
+        gapChunksLeft--;
+        if (gapChunksLeft == 0)
+        {
+            CCPR1 = activeLastChunkTicks;
+        }
+        return false;
+    }
+
+    pulseInBurst++;
+    if (pulseInBurst < activePulses)
+    {
+        CCPR1 = spacingTicks;
+        return true;
+    }
+
+    // Last pulse of the burst, on to the gap
+    gapChunksLeft = nextPlan.gapChunks;
+    activeLastChunkTicks = nextPlan.lastChunkTicks;
+    CCPR1 = (gapChunksLeft != 0) ? BURST_GAP_CHUNK_TICKS : activeLastChunkTicks;
+    activePulses = nextPlan.pulses;
+    planConsumed = true;
+    pulseInBurst = 0;
+    burstCount++;
+
+    return true;
+}
+
+uint16_t Burst_GetBurstCount(void)
+{
+    bool interruptEnabled;
+    uint16_t count;
+
+    interruptEnabled = PIE1bits.CCP1IE;
+    PIE1bits.CCP1IE = 0;
+    count = burstCount;
+    PIE1bits.CCP1IE = interruptEnabled;
+
+    return count;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef BURST_H
+#define BURST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The compare interrupt has to be done with one pulse before the next
+// match, this leaves room for the pulse itself and interrupt overhead
+#define BURST_MIN_SPACING_US    (40)
+// Gaps longer than one Timer3 period are made up of matches that don't pulse
+#define BURST_GAP_CHUNK_TICKS   (30000) // 20 ms
+
+extern volatile bool burstActive;
+
+uint16_t Burst_Start(uint16_t pulsesPerBurst, uint16_t spacing, uint16_t gap, uint8_t variation);
+void Burst_Stop(void);
+void Burst_Service(void);
+bool Burst_CompareIsr(void);
+uint16_t Burst_GetBurstCount(void);
+
+#endif // BURST_H
\ No newline at end of file
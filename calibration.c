@@ -0,0 +1,260 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+#include "init.h"
+#include "utils.h"
+#include "flash.h"
+#include "powerlossemu.h"
+#include "calibration.h"
+
+#define CALIBRATION_MAGIC       (0xCA)
+#define CYCLES_PER_MICROSECOND  (12)
+#define CYCLES_PER_TICK         (8)
+
+typedef struct calibrationRecord
+{
+    uint8_t             magic;
+    int16_t             offsetCycles[CALIBRATION_POINTS];
+    uint8_t             checksum;
+} calibrationRecord_t;
+
+// Keeps the linker off the calibration page, below the checkpoint ones
+const uint8_t calibrationFlash[FLASH_ERASE_BLOCK_SIZE] __at(CALIBRATION_ADDRESS);
+
+// Short periods are where a tick matters most, past 5 ms Timer1 wraps
+// within a period
+static const uint16_t calibrationPoints[CALIBRATION_POINTS] =
+{
+    20, 50, 100, 200, 500, 1000, 2000, 5000,
+};
+
+volatile bool calibrationActive;
+
+// Cycles the achieved period is longer than CCPR1 x 8, at each point
+static int16_t offsetCycles[CALIBRATION_POINTS];
+
+// Interrupt state
+static bool haveStamp;
+static uint16_t lastStamp;
+static volatile uint32_t cyclesSum;
+static volatile uint8_t intervals;
+
+static uint8_t Calibration_Sum(const void *data, uint16_t length)
+{
+    const uint8_t *byte = (const uint8_t *)data;
+    uint8_t sum = 0;
+
+    while (length-- != 0)
+    {
+        sum += *byte++;
+    }
+
+    return sum;
+}
+
+static int16_t Calibration_GetOffset(uint16_t microseconds)
+{
+    uint8_t i;
+    int32_t span;
+
+    if (microseconds <= calibrationPoints[0])
+    {
+        return offsetCycles[0];
+    }
+    for (i = 1; i < CALIBRATION_POINTS; i++)
+    {
+        if (microseconds < calibrationPoints[i])
+        {
+            // Straight line between the points either side
+            span = calibrationPoints[i] - calibrationPoints[i - 1];
+            return offsetCycles[i - 1] + (int16_t)((((int32_t)offsetCycles[i] - offsetCycles[i - 1]) * (microseconds - calibrationPoints[i - 1])) / span);
+        }
+    }
+
+    return offsetCycles[CALIBRATION_POINTS - 1];
+}
+
+// Measures the average period for a raw compare value, returns false if the
+// matches didn't come
+static bool Calibration_Measure(uint16_t ticks, int16_t *offset)
+{
+    uint32_t startTime;
+    uint32_t timeout;
+    uint32_t sum;
+
+    INTCONbits.GIEH = 0;
+    haveStamp = false;
+    cyclesSum = 0;
+    intervals = 0;
+    INTCONbits.GIEH = 1;
+    // Four times as long as it should take, plus a bit for the short ones
+    timeout = ((((uint32_t)ticks * 2) / 3) * (CALIBRATION_INTERVALS + 1) * 4) + 10000;
+    startTime = Util_GetMicrosecondUptime();
+    Util_SetCompareTicks(ticks);
+    while ((intervals < CALIBRATION_INTERVALS) && ((Util_GetMicrosecondUptime() - startTime) < timeout))
+    {
+    }
+    Util_SetCompareTicks(0);
+
+    if (intervals < CALIBRATION_INTERVALS)
+    {
+        return false;
+    }
+    INTCONbits.GIEH = 0;
+    sum = cyclesSum;
+    INTCONbits.GIEH = 1;
+    // Round to the nearest cycle
+    *offset = (int16_t)((int32_t)((sum + (CALIBRATION_INTERVALS / 2)) / CALIBRATION_INTERVALS) - ((int32_t)ticks * CYCLES_PER_TICK));
+
+    return true;
+}
+
+static void Calibration_Print(void)
+{
+    Console_Print("Period    Offset");
+    for (uint8_t i = 0; i < CALIBRATION_POINTS; i++)
+    {
+        Console_Print("%5u us %6ld ns", calibrationPoints[i], ((int32_t)offsetCycles[i] * 1000) / CYCLES_PER_MICROSECOND);
+    }
+}
+
+// Measures every point and stores the table, the old table stays in use if
+// anything looks wrong
+static bool Calibration_MeasureAll(void)
+{
+    int16_t measured[CALIBRATION_POINTS];
+    calibrationRecord_t record;
+
+    // Timer1 is the reference, it's only running already when profiling is
+    // compiled in
+    Init_Timer1();
+    calibrationActive = true;
+    for (uint8_t i = 0; i < CALIBRATION_POINTS; i++)
+    {
+        if (!Calibration_Measure(Util_MicrosecondsToTicks(calibrationPoints[i]), &measured[i]) ||
+            (measured[i] > CALIBRATION_MAX_OFFSET) || (measured[i] < -CALIBRATION_MAX_OFFSET))
+        {
+            calibrationActive = false;
+            Console_Print(ANSI_COLOR_RED" Period calibration failed at %u us!"ANSI_COLOR_RESET, calibrationPoints[i]);
+            return false;
+        }
+    }
+    calibrationActive = false;
+
+    record.magic = CALIBRATION_MAGIC;
+    for (uint8_t i = 0; i < CALIBRATION_POINTS; i++)
+    {
+        offsetCycles[i] = measured[i];
+        record.offsetCycles[i] = measured[i];
+    }
+    record.checksum = (uint8_t)(-Calibration_Sum(&record, sizeof(calibrationRecord_t) - 1));
+    // Nothing is pulsing yet, so the stall can't get in the way
+    if (!Flash_Erase(CALIBRATION_ADDRESS) || !Flash_Write(CALIBRATION_ADDRESS, &record, sizeof(calibrationRecord_t)))
+    {
+        Console_Print(ANSI_COLOR_RED" Couldn't store the period calibration, it'll be redone next boot"ANSI_COLOR_RESET);
+    }
+
+    return true;
+}
+
+// Loads the table from flash, or measures it if there isn't one yet
+void Calibration_Init(void)
+{
+    calibrationRecord_t record;
+
+    Flash_Read(CALIBRATION_ADDRESS, &record, sizeof(calibrationRecord_t));
+    if ((record.magic == CALIBRATION_MAGIC) && (Calibration_Sum(&record, sizeof(calibrationRecord_t)) == 0))
+    {
+        for (uint8_t i = 0; i < CALIBRATION_POINTS; i++)
+        {
+            offsetCycles[i] = record.offsetCycles[i];
+        }
+        return;
+    }
+
+    Console_Print("Calibrating periods against Timer1...");
+    if (Calibration_MeasureAll())
+    {
+        Calibration_Print();
+    }
+}
+
+// Compare value that gives the closest period to the one asked for
+uint16_t Calibration_PeriodToTicks(uint16_t microseconds)
+{
+    int32_t cycles;
+
+    cycles = ((int32_t)microseconds * CYCLES_PER_MICROSECOND) - Calibration_GetOffset(microseconds);
+    cycles = (cycles + (CYCLES_PER_TICK / 2)) / CYCLES_PER_TICK;
+    if (cycles < 1)
+    {
+        return 1;
+    }
+    if (cycles > UINT16_MAX)
+    {
+        return UINT16_MAX;
+    }
+
+    return (uint16_t)cycles;
+}
+
+// Called at the end of the ECCP1 branch on every match while calibrating.
+// Only the first and last stamps matter for the sum, so the interrupt
+// latency drops out apart from its jitter at the two ends.
+void Calibration_CompareIsr(void)
+{
+    uint16_t now = TMR1;
+
+    if (haveStamp && (intervals < CALIBRATION_INTERVALS))
+    {
+        cyclesSum += (uint16_t)(now - lastStamp);
+        intervals++;
+    }
+    haveStamp = true;
+    lastStamp = now;
+}
+
+functionResult_e Calibration_Run(unsigned int numArgs, int args[])
+{
+    // Calibrating needs the comparator to itself
+    if (PowerLossEmu_IsRunning())
+    {
+        Console_Print(ANSI_COLOR_RED" Stop the running workload first!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+
+    Console_Print("Calibrating periods against Timer1, RB0 stays quiet...");
+    if (!Calibration_MeasureAll())
+    {
+        return ERROR;
+    }
+    Calibration_Print();
+
+    return SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+
+// The period that comes out of ECCP1 isn't exactly CCPR1 Timer3 ticks, the
+// special event reset and the timer restart add a little. At boot the
+// offset is measured at a handful of periods against Timer1, which counts
+// instruction cycles (8 to a Timer3 tick), and kept in flash. Commanded
+// periods are turned into compare values with the offset interpolated out
+// and rounded to the nearest tick. Above the last point its offset is held.
+#define CALIBRATION_POINTS      (8)
+#define CALIBRATION_INTERVALS   (64)    // Periods averaged per point
+#define CALIBRATION_ADDRESS     (0xEC00)
+// Anything bigger than this is a measurement gone wrong, not an overhead
+#define CALIBRATION_MAX_OFFSET  (64)    // Cycles
+
+extern volatile bool calibrationActive;
+
+void Calibration_Init(void);
+uint16_t Calibration_PeriodToTicks(uint16_t microseconds);
+void Calibration_CompareIsr(void);
+functionResult_e Calibration_Run(unsigned int numArgs, int args[]);
+
+#endif // CALIBRATION_H
\ No newline at end of file
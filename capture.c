@@ -0,0 +1,313 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <conio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+#include "utils.h"
+#include "telemetry.h"
+#include "capture.h"
+
+#define CAPTURE_INDEX_MASK          (CAPTURE_MAX_SAMPLES - 1)
+
+#if (CAPTURE_MAX_SAMPLES & CAPTURE_INDEX_MASK) != 0
+#error "CAPTURE_MAX_SAMPLES has to be a power of two"
+#endif
+
+typedef enum
+{
+    CAPTURE_STATE_IDLE = 0,
+    CAPTURE_STATE_PRE,          // Free-running into the ring
+    CAPTURE_STATE_WAIT_TRIGGER, // Stopped so the special event can start one
+    CAPTURE_STATE_POST,
+    CAPTURE_STATE_DONE,
+} captureState_e;
+
+static captureMode_e captureMode;
+static uint16_t preSamples = CAPTURE_DEFAULT_PRE_SAMPLES;
+
+static uint16_t samples[CAPTURE_MAX_SAMPLES];
+static volatile captureState_e captureState;
+static uint16_t sampleIndex;
+static uint16_t preAvailable;
+static uint16_t postLeft;
+static uint16_t triggerIndex;
+static uint32_t triggerTime;
+static uint32_t triggerPulse;
+static uint32_t endTime;
+static uint16_t captureSequence;
+
+// Frame currently being shifted out
+static captureHeader_t header;
+static uint8_t headerBytesLeft;
+static uint8_t *headerPointer;
+static uint16_t samplesLeft;
+static uint16_t sendIndex;
+static uint8_t sampleByte;
+static uint8_t checksum;
+static bool sending;
+
+static void Capture_Arm(void)
+{
+    PIE1bits.ADIE = 0;
+    sampleIndex = 0;
+    preAvailable = 0;
+    captureState = CAPTURE_STATE_PRE;
+    PIR1bits.ADIF = 0;
+    PIE1bits.ADIE = 1;
+    ADCON0bits.GO = 1;
+}
+
+static void Capture_BuildHeader(void)
+{
+    header.sync[0] = TELEMETRY_SYNC_BYTE_0;
+    header.sync[1] = TELEMETRY_SYNC_BYTE_1;
+    header.type = TELEMETRY_FRAME_TYPE_CAPTURE;
+    header.sequence = captureSequence++;
+    header.pulse = triggerPulse;
+    header.sampleCount = CAPTURE_MAX_SAMPLES - preSamples + preAvailable;
+    header.triggerIndex = preAvailable;
+    header.span = endTime - triggerTime;
+
+    headerPointer = (uint8_t *)&header;
+    headerBytesLeft = sizeof(captureHeader_t);
+    // Oldest sample first
+    sendIndex = (triggerIndex - preAvailable) & CAPTURE_INDEX_MASK;
+    samplesLeft = header.sampleCount;
+    sampleByte = 0;
+    checksum = 0;
+    sending = true;
+}
+
+// Returns false once the whole frame has been handed over
+static bool Capture_NextByte(uint8_t *c)
+{
+    if (headerBytesLeft != 0)
+    {
+        *c = *headerPointer++;
+        headerBytesLeft--;
+    }
+    else if (samplesLeft != 0)
+    {
+        if (sampleByte == 0)
+        {
+            *c = (uint8_t)samples[sendIndex];
+            sampleByte = 1;
+        }
+        else
+        {
+            *c = (uint8_t)(samples[sendIndex] >> 8);
+            sampleByte = 0;
+            sendIndex = (sendIndex + 1) & CAPTURE_INDEX_MASK;
+            samplesLeft--;
+        }
+    }
+    else if (sending)
+    {
+        *c = (uint8_t)(-checksum);
+        sending = false;
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+    checksum += *c;
+
+    return true;
+}
+
+bool Capture_IsStreaming(void)
+{
+    return (captureMode == CAPTURE_MODE_STREAM);
+}
+
+void Capture_Start(void)
+{
+    captureSequence = 0;
+    sending = false;
+    if (captureMode != CAPTURE_MODE_OFF)
+    {
+        Capture_Arm();
+    }
+}
+
+void Capture_Service(void)
+{
+    uint8_t c;
+
+    if (sending)
+    {
+        // Only ever load the transmit register when it's empty
+        while (TXIF && Capture_NextByte(&c))
+        {
+            TXREG1 = c;
+        }
+        if (!sending)
+        {
+            Capture_Arm();
+        }
+    }
+    else if (captureState == CAPTURE_STATE_DONE)
+    {
+        Capture_BuildHeader();
+    }
+}
+
+void Capture_Stop(void)
+{
+    uint8_t c;
+
+    PIE1bits.ADIE = 0;
+    // Pulses are off by now, so it's safe to block until the frame is out
+    while (Capture_NextByte(&c))
+    {
+        putch(c);
+    }
+    if (captureState != CAPTURE_STATE_DONE)
+    {
+        captureState = CAPTURE_STATE_IDLE;
+    }
+}
+
+// Called from the A/D interrupt each time a conversion completes
+void Capture_AdcIsr(void)
+{
+    // Special events keep starting conversions once a capture is done, they
+    // mustn't land on the oldest sample while it's held or going out
+    if ((captureState != CAPTURE_STATE_PRE) && (captureState != CAPTURE_STATE_WAIT_TRIGGER) && (captureState != CAPTURE_STATE_POST))
+    {
+        return;
+    }
+    samples[sampleIndex] = ADRES;
+
+    switch (captureState)
+    {
+        case CAPTURE_STATE_PRE:
+            sampleIndex = (sampleIndex + 1) & CAPTURE_INDEX_MASK;
+            if (preAvailable < preSamples)
+            {
+                preAvailable++;
+            }
+            // Once the pre-trigger window is full, stay idle through the
+            // next match if another conversion wouldn't be done by then
+            if ((preAvailable < preSamples) || ((uint16_t)(CCPR1 - TMR3) > (2 * CAPTURE_CONVERSION_TICKS)))
+            {
+                ADCON0bits.GO = 1;
+            }
+            else
+            {
+                captureState = CAPTURE_STATE_WAIT_TRIGGER;
+            }
+            break;
+        case CAPTURE_STATE_WAIT_TRIGGER:
+            // This one was started by the special event
+            triggerIndex = sampleIndex;
+            triggerTime = uptimeTicksMicroSeconds;
+            triggerPulse = Util_GetPulseCount();
+            sampleIndex = (sampleIndex + 1) & CAPTURE_INDEX_MASK;
+            postLeft = CAPTURE_MAX_SAMPLES - preSamples - 1;
+            if (postLeft == 0)
+            {
+                endTime = triggerTime;
+                captureState = CAPTURE_STATE_DONE;
+                PIE1bits.ADIE = 0;
+            }
+            else
+            {
+                captureState = CAPTURE_STATE_POST;
+                ADCON0bits.GO = 1;
+            }
+            break;
+        case CAPTURE_STATE_POST:
+            sampleIndex = (sampleIndex + 1) & CAPTURE_INDEX_MASK;
+            postLeft--;
+            if (postLeft == 0)
+            {
+                endTime = uptimeTicksMicroSeconds;
+                captureState = CAPTURE_STATE_DONE;
+                PIE1bits.ADIE = 0;
+            }
+            else
+            {
+                ADCON0bits.GO = 1;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+functionResult_e Capture_Setup(unsigned int numArgs, int args[])
+{
+    unsigned int mode;
+    unsigned int pre;
+
+    Console_Print("Capture mode %d with %u of %u samples before the trigger", captureMode, preSamples, CAPTURE_MAX_SAMPLES);
+    // Arguments: mode [preSamples]
+    mode = Console_ArgOrPromptForInt(numArgs, args, 0, "Enter mode (0 = off, 1 = stream, 2 = single): ");
+    if (mode >= NUM_CAPTURE_MODES)
+    {
+        Console_Print(ANSI_COLOR_RED"Invalid mode!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+    captureMode = (captureMode_e)mode;
+    if (captureMode != CAPTURE_MODE_OFF)
+    {
+        pre = Console_ArgOrPromptForInt(numArgs, args, 1, "Enter pre-trigger samples: ");
+        if (pre >= CAPTURE_MAX_SAMPLES)
+        {
+            Console_Print(ANSI_COLOR_RED"Need at least one sample for the trigger!"ANSI_COLOR_RESET);
+            return ERROR;
+        }
+        preSamples = pre;
+        if (Telemetry_IsEnabled() && (captureMode == CAPTURE_MODE_STREAM))
+        {
+            Console_Print("Capture frames take the link over from telemetry during runs");
+        }
+    }
+
+    return SUCCESS;
+}
+
+functionResult_e Capture_Download(unsigned int numArgs, int args[])
+{
+    uint8_t c;
+
+    if (captureState != CAPTURE_STATE_DONE)
+    {
+        Console_Print(ANSI_COLOR_RED"No complete capture to download!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+    Capture_BuildHeader();
+    while (Capture_NextByte(&c))
+    {
+        putch(c);
+    }
+
+    return SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+
+// Records AN0 (RA0) around power-loss events. The ADC free-runs into a ring
+// buffer, stops just before the next compare match and lets the ECCP1
+// special event start the trigger conversion, then carries on for the
+// post-trigger window.
+// Biggest buffer in RAM, builds can trade it off with -DCAPTURE_MAX_SAMPLES
+#ifndef CAPTURE_MAX_SAMPLES
+#define CAPTURE_MAX_SAMPLES         (1024)  // Power of two
+#endif
+// One conversion is 2 TAD acquisition + 11 TAD at FOSC/64, about 17.3 us
+#define CAPTURE_CONVERSION_TICKS    (26)
+#define CAPTURE_DEFAULT_PRE_SAMPLES (64)
+
+typedef enum
+{
+    CAPTURE_MODE_OFF = 0,
+    CAPTURE_MODE_STREAM,    // Send every capture as it completes
+    CAPTURE_MODE_SINGLE,    // Keep the first capture of a run for Download
+    NUM_CAPTURE_MODES,
+} captureMode_e;
+
+// Sent ahead of the samples, which follow as little-endian uint16_t and
+// then a checksum byte covering the header and samples the same way as
+// telemetry frames
+typedef struct captureHeader
+{
+    uint8_t             sync[2];
+    uint8_t             type;
+    uint16_t            sequence;
+    uint32_t            pulse;          // Pulse number that triggered it
+    uint16_t            sampleCount;
+    uint16_t            triggerIndex;   // Sample started by the special event
+    uint32_t            span;           // us from trigger to the last sample
+} captureHeader_t;
+
+bool Capture_IsStreaming(void);
+void Capture_Start(void);
+void Capture_Service(void);
+void Capture_Stop(void);
+void Capture_AdcIsr(void);
+functionResult_e Capture_Setup(unsigned int numArgs, int args[]);
+functionResult_e Capture_Download(unsigned int numArgs, int args[]);
+
+#endif // CAPTURE_H
\ No newline at end of file
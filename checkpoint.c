@@ -0,0 +1,449 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "console.h"
+#include "utils.h"
+#include "flash.h"
+#include "playlist.h"
+#include "powerlossemu.h"
+#include "checkpoint.h"
+
+// Flash layout, seven erase blocks just below the configuration words:
+//
+//   0xE000  Run header block, then the segment settings, then one write
+//           block of final statistics per segment. Written once per run.
+//   0xE400  Progress records, one per write block, the newest valid record
+//   ...     is the one to resume from. Erasing a page stalls for longer
+//   0xF800  than most periods, so every page is erased before pulses start
+//           and the log is made long enough to last most runs. Only once
+//           it's full does it wrap, and then only in a gap long enough to
+//           erase the oldest page.
+#define CHECKPOINT_HEADER_ADDRESS   (0xE000)
+#define CHECKPOINT_SEGMENTS_ADDRESS (CHECKPOINT_HEADER_ADDRESS + FLASH_WRITE_BLOCK_SIZE)
+#define CHECKPOINT_SEGMENTS_SIZE    (PLAYLIST_MAX_SEGMENTS * sizeof(workloadSettings_t))
+#define CHECKPOINT_STATS_ADDRESS    (CHECKPOINT_SEGMENTS_ADDRESS + ((CHECKPOINT_SEGMENTS_SIZE + FLASH_WRITE_BLOCK_SIZE - 1) & ~(FLASH_WRITE_BLOCK_SIZE - 1)))
+#define CHECKPOINT_PROGRESS_ADDRESS (0xE400)
+#define CHECKPOINT_PROGRESS_PAGES   (6)
+#define CHECKPOINT_SLOTS_PER_PAGE   (FLASH_ERASE_BLOCK_SIZE / FLASH_WRITE_BLOCK_SIZE)
+#define CHECKPOINT_SLOTS            (CHECKPOINT_PROGRESS_PAGES * CHECKPOINT_SLOTS_PER_PAGE)
+#define CHECKPOINT_MAGIC            (0xCC)    // Bump when workloadSettings_t or the records change
+// Every checkpoint costs a write, and a full log an erase
+#define CHECKPOINT_MIN_INTERVAL_S   (60)
+#define CHECKPOINT_PAGE_ADDRESS(page)   (CHECKPOINT_PROGRESS_ADDRESS + ((uint16_t)(page) * FLASH_ERASE_BLOCK_SIZE))
+
+typedef enum
+{
+    CHECKPOINT_STATE_RUNNING = 0x52,    // 'R'
+    CHECKPOINT_STATE_DONE = 0x44,       // 'D'
+} checkpointState_e;
+
+// The checksum of the header covers the segment settings after it too
+typedef struct checkpointHeader
+{
+    uint8_t             magic;
+    uint8_t             numSegments;
+    uint32_t            pulseTarget;
+    uint8_t             checksum;
+} checkpointHeader_t;
+
+typedef struct checkpointStatsRecord
+{
+    uint8_t             magic;
+    workloadStats_t     stats;
+    uint8_t             checksum;
+} checkpointStatsRecord_t;
+
+typedef struct checkpointRecord
+{
+    uint8_t             magic;
+    uint8_t             state;
+    uint16_t            sequence;
+    checkpointProgress_t progress;
+    uint8_t             checksum;
+} checkpointRecord_t;
+
+// Keeps the linker away from the checkpoint pages, they aren't programmed
+// so they start out erased
+const uint8_t checkpointFlash[(1 + CHECKPOINT_PROGRESS_PAGES) * FLASH_ERASE_BLOCK_SIZE] __at(CHECKPOINT_HEADER_ADDRESS);
+
+static uint16_t checkpointInterval = CHECKPOINT_DEFAULT_INTERVAL_S;
+static uint16_t checkpointsWritten;
+static uint16_t checkpointsReplaced;
+
+// Run being checkpointed
+static bool runOpen;
+static const workloadStats_t *runStats;
+static uint32_t lastSaveTime;   // s
+static uint16_t sequence;
+static uint8_t nextSlot;
+static uint8_t erasedSlots;     // From nextSlot on
+
+// Flash work waiting for a long enough gap between pulses
+static checkpointRecord_t pendingRecord;
+static bool recordPending;
+static bool erasePending;
+static uint8_t statsPending;    // One bit per segment
+
+static uint8_t Checkpoint_Sum(const void *data, uint16_t length)
+{
+    const uint8_t *byte = (const uint8_t *)data;
+    uint8_t sum = 0;
+
+    while (length-- != 0)
+    {
+        sum += *byte++;
+    }
+
+    return sum;
+}
+
+static uint16_t Checkpoint_SlotAddress(uint8_t slot)
+{
+    return CHECKPOINT_PROGRESS_ADDRESS + ((uint16_t)slot * FLASH_WRITE_BLOCK_SIZE);
+}
+
+static void Checkpoint_Open(const workloadStats_t stats[])
+{
+    runStats = stats;
+    recordPending = false;
+    erasePending = false;
+    statsPending = 0;
+    checkpointsWritten = 0;
+    checkpointsReplaced = 0;
+    lastSaveTime = Util_GetSecondUptime();
+    runOpen = true;
+}
+
+static void Checkpoint_SealRecord(checkpointState_e state)
+{
+    pendingRecord.magic = CHECKPOINT_MAGIC;
+    pendingRecord.state = state;
+    pendingRecord.sequence = sequence;
+    pendingRecord.checksum = (uint8_t)(-Checkpoint_Sum(&pendingRecord, sizeof(checkpointRecord_t) - 1));
+    recordPending = true;
+}
+
+bool Checkpoint_IsEnabled(void)
+{
+    return (checkpointInterval != 0);
+}
+
+bool Checkpoint_WasUnexpectedReset(void)
+{
+    bool unexpected;
+
+    // The flags are active low and stay put until they're set again. A
+    // power-on reset clears BOR as well, so only BOR on its own counts.
+    unexpected = !RCONbits.NOT_TO || (!RCONbits.NOT_BOR && RCONbits.NOT_POR);
+    RCONbits.NOT_POR = 1;
+    RCONbits.NOT_BOR = 1;
+    CLRWDT();   // Sets TO again
+
+    return unexpected;
+}
+
+// Pulses haven't started yet, so none of the flash work here is deferred
+void Checkpoint_Begin(const workloadSettings_t segments[], const workloadStats_t stats[], uint8_t numSegments, uint32_t pulseTarget)
+{
+    checkpointHeader_t header;
+    uint16_t length = numSegments * sizeof(workloadSettings_t);
+    uint16_t chunk;
+
+    // Even a run that doesn't checkpoint mustn't leave an older one behind
+    // to be resumed
+    runOpen = false;
+    Flash_Erase(CHECKPOINT_HEADER_ADDRESS);
+    if (!Checkpoint_IsEnabled())
+    {
+        return;
+    }
+    for (uint8_t page = 0; page < CHECKPOINT_PROGRESS_PAGES; page++)
+    {
+        Flash_Erase(CHECKPOINT_PAGE_ADDRESS(page));
+    }
+
+    header.magic = CHECKPOINT_MAGIC;
+    header.numSegments = numSegments;
+    header.pulseTarget = pulseTarget;
+    header.checksum = (uint8_t)(-(Checkpoint_Sum(&header, sizeof(checkpointHeader_t) - 1) + Checkpoint_Sum(segments, length)));
+    Flash_Write(CHECKPOINT_HEADER_ADDRESS, &header, sizeof(checkpointHeader_t));
+    for (uint16_t offset = 0; offset < length; offset += FLASH_WRITE_BLOCK_SIZE)
+    {
+        chunk = length - offset;
+        if (chunk > FLASH_WRITE_BLOCK_SIZE)
+        {
+            chunk = FLASH_WRITE_BLOCK_SIZE;
+        }
+        Flash_Write(CHECKPOINT_SEGMENTS_ADDRESS + offset, (const uint8_t *)segments + offset, (uint8_t)chunk);
+    }
+
+    sequence = 0;
+    nextSlot = 0;
+    erasedSlots = CHECKPOINT_SLOTS;
+    Checkpoint_Open(stats);
+}
+
+// Returns true if the last run was still going at its newest checkpoint.
+// Segments before the one in progress get their final statistics back.
+bool Checkpoint_Load(workloadSettings_t segments[], workloadStats_t stats[], uint8_t *numSegments, uint32_t *pulseTarget, checkpointProgress_t *progress)
+{
+    checkpointHeader_t header;
+    checkpointRecord_t record;
+    checkpointStatsRecord_t statsRecord;
+    bool found = false;
+    uint8_t latestSlot = 0;
+
+    Flash_Read(CHECKPOINT_HEADER_ADDRESS, &header, sizeof(checkpointHeader_t));
+    if ((header.magic != CHECKPOINT_MAGIC) || (header.numSegments == 0) || (header.numSegments > PLAYLIST_MAX_SEGMENTS))
+    {
+        return false;
+    }
+    Flash_Read(CHECKPOINT_SEGMENTS_ADDRESS, segments, header.numSegments * sizeof(workloadSettings_t));
+    if ((uint8_t)(Checkpoint_Sum(&header, sizeof(checkpointHeader_t)) + Checkpoint_Sum(segments, header.numSegments * sizeof(workloadSettings_t))) != 0)
+    {
+        return false;
+    }
+
+    // The log never holds more than CHECKPOINT_SLOTS records, so comparing
+    // sequence numbers still works when they wrap. The newest one is kept
+    // to carry on logging after.
+    for (uint8_t slot = 0; slot < CHECKPOINT_SLOTS; slot++)
+    {
+        Flash_Read(Checkpoint_SlotAddress(slot), &record, sizeof(checkpointRecord_t));
+        if ((record.magic != CHECKPOINT_MAGIC) || (Checkpoint_Sum(&record, sizeof(checkpointRecord_t)) != 0))
+        {
+            continue;
+        }
+        if (!found || ((int16_t)(record.sequence - sequence) > 0))
+        {
+            found = true;
+            sequence = record.sequence;
+            latestSlot = slot;
+            pendingRecord = record;
+        }
+    }
+    if (!found || (pendingRecord.state != CHECKPOINT_STATE_RUNNING) || (pendingRecord.progress.segment >= header.numSegments))
+    {
+        return false;
+    }
+    *progress = pendingRecord.progress;
+
+    for (uint8_t i = 0; i < progress->segment; i++)
+    {
+        Flash_Read(CHECKPOINT_STATS_ADDRESS + ((uint16_t)i * FLASH_WRITE_BLOCK_SIZE), &statsRecord, sizeof(checkpointStatsRecord_t));
+        if ((statsRecord.magic == CHECKPOINT_MAGIC) && (Checkpoint_Sum(&statsRecord, sizeof(checkpointStatsRecord_t)) == 0))
+        {
+            stats[i] = statsRecord.stats;
+        }
+        else
+        {
+            memset(&stats[i], 0, sizeof(workloadStats_t));
+        }
+    }
+
+    *numSegments = header.numSegments;
+    *pulseTarget = header.pulseTarget;
+    // Carry on logging after the record being resumed from
+    sequence++;
+    nextSlot = (latestSlot + 1) % CHECKPOINT_SLOTS;
+
+    return true;
+}
+
+// Picks the log back up after Checkpoint_Load, before pulses restart. The
+// record being resumed from is copied to the start of the next page so
+// every other page can be erased while there's still one good record.
+void Checkpoint_Continue(const workloadStats_t stats[])
+{
+    uint8_t latestPage;
+    uint8_t nextPage;
+
+    if (!Checkpoint_IsEnabled())
+    {
+        // Turned off since, close the old run so it isn't resumed again
+        runOpen = false;
+        Flash_Erase(CHECKPOINT_HEADER_ADDRESS);
+        return;
+    }
+
+    latestPage = (uint8_t)(((nextSlot + CHECKPOINT_SLOTS - 1) % CHECKPOINT_SLOTS) / CHECKPOINT_SLOTS_PER_PAGE);
+    nextPage = (latestPage + 1) % CHECKPOINT_PROGRESS_PAGES;
+    for (uint8_t page = 0; page < CHECKPOINT_PROGRESS_PAGES; page++)
+    {
+        if (page != latestPage)
+        {
+            Flash_Erase(CHECKPOINT_PAGE_ADDRESS(page));
+        }
+    }
+    Checkpoint_SealRecord(CHECKPOINT_STATE_RUNNING);
+    Flash_Write(CHECKPOINT_PAGE_ADDRESS(nextPage), &pendingRecord, sizeof(checkpointRecord_t));
+    Flash_Erase(CHECKPOINT_PAGE_ADDRESS(latestPage));
+
+    sequence++;
+    nextSlot = (uint8_t)((nextPage * CHECKPOINT_SLOTS_PER_PAGE) + 1);
+    erasedSlots = CHECKPOINT_SLOTS - 1;
+    Checkpoint_Open(stats);
+}
+
+bool Checkpoint_IsDue(uint32_t currentSeconds)
+{
+    return runOpen && ((currentSeconds - lastSaveTime) >= checkpointInterval);
+}
+
+// Only queues the record, Checkpoint_Service writes it when it can
+void Checkpoint_Save(const checkpointProgress_t *progress, uint32_t currentSeconds)
+{
+    if (!runOpen)
+    {
+        return;
+    }
+
+    lastSaveTime = currentSeconds;
+    if (recordPending)
+    {
+        // Pulses have been too close together to write the last one
+        checkpointsReplaced++;
+    }
+    pendingRecord.progress = *progress;
+    Checkpoint_SealRecord(CHECKPOINT_STATE_RUNNING);
+}
+
+// The segment's statistics are final, queue them for the run header
+void Checkpoint_SegmentDone(uint8_t segment)
+{
+    if (runOpen)
+    {
+        statsPending |= (uint8_t)(1 << segment);
+    }
+}
+
+// Does at most one erase or write per call, each one needs its own gap
+// between pulses. Statistics go before progress so a record never points
+// past a segment whose statistics are missing.
+void Checkpoint_Service(void)
+{
+    checkpointStatsRecord_t statsRecord;
+    uint8_t segment = 0;
+
+    if (!runOpen)
+    {
+        return;
+    }
+
+    if (erasePending)
+    {
+        // Hardly any period leaves a gap long enough for an erase, records
+        // keep being replaced until one does
+        if (Flash_Erase(Checkpoint_SlotAddress(nextSlot)))
+        {
+            erasedSlots = CHECKPOINT_SLOTS_PER_PAGE;
+            erasePending = false;
+        }
+    }
+    else if (statsPending != 0)
+    {
+        while ((statsPending & (1 << segment)) == 0)
+        {
+            segment++;
+        }
+        statsRecord.magic = CHECKPOINT_MAGIC;
+        statsRecord.stats = runStats[segment];
+        statsRecord.checksum = (uint8_t)(-Checkpoint_Sum(&statsRecord, sizeof(checkpointStatsRecord_t) - 1));
+        if (Flash_Write(CHECKPOINT_STATS_ADDRESS + ((uint16_t)segment * FLASH_WRITE_BLOCK_SIZE), &statsRecord, sizeof(checkpointStatsRecord_t)))
+        {
+            statsPending &= (uint8_t)~(1 << segment);
+        }
+    }
+    else if (recordPending)
+    {
+        if (Flash_Write(Checkpoint_SlotAddress(nextSlot), &pendingRecord, sizeof(checkpointRecord_t)))
+        {
+            recordPending = false;
+            checkpointsWritten++;
+            sequence++;
+            nextSlot = (nextSlot + 1) % CHECKPOINT_SLOTS;
+            // The log is full, the oldest page has to go before the next record
+            erasePending = (--erasedSlots == 0);
+        }
+    }
+}
+
+// Pulses are off by now, so nothing can be deferred any more. The last
+// record marks the run done so it's never resumed.
+void Checkpoint_End(void)
+{
+    if (!runOpen)
+    {
+        return;
+    }
+
+    Checkpoint_SealRecord(CHECKPOINT_STATE_DONE);
+    while (erasePending || (statsPending != 0) || recordPending)
+    {
+        Checkpoint_Service();
+    }
+    runOpen = false;
+}
+
+functionResult_e Checkpoint_Setup(unsigned int numArgs, int args[])
+{
+    uint16_t interval;
+
+    if (Checkpoint_IsEnabled())
+    {
+        Console_Print("Runs checkpoint to flash every %u s", checkpointInterval);
+        Console_Print("Last run wrote %u, %u replaced while pulses were too close together", checkpointsWritten, checkpointsReplaced);
+    }
+    else
+    {
+        Console_Print("Checkpoints are off");
+    }
+    // Arguments: interval
+    interval = Console_ArgOrPromptForInt(numArgs, args, 0, "Enter checkpoint interval (s, 0 = off): ");
+    if ((interval != 0) && (interval < CHECKPOINT_MIN_INTERVAL_S))
+    {
+        Console_Print("Limiting interval to %d s for flash endurance", CHECKPOINT_MIN_INTERVAL_S);
+        interval = CHECKPOINT_MIN_INTERVAL_S;
+    }
+    checkpointInterval = interval;
+    if (Checkpoint_IsEnabled())
+    {
+        Console_Print("Runs resume from their last checkpoint after a brown-out or watchdog reset");
+        Console_Print("Checkpoints are only written with more than %d ms to the next pulse", FLASH_WRITE_BUDGET_US / MICROSECONDS_IN_MILLISECONDS);
+        Console_Print("The log holds %d checkpoints (%lu min), after that a page is only erased in a gap of more than %lu ms",
+                      CHECKPOINT_SLOTS, ((uint32_t)CHECKPOINT_SLOTS * checkpointInterval) / 60,
+                      (uint32_t)FLASH_ERASE_BUDGET_US / MICROSECONDS_IN_MILLISECONDS);
+    }
+    else
+    {
+        Console_Print("Checkpoints off, runs can't be resumed after a reset");
+    }
+
+    return SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+#include "powerlossemu.h"
+
+// The progress log is erased once per run, at 300 s it lasts eight hours
+// before a page has to be erased again
+#define CHECKPOINT_DEFAULT_INTERVAL_S   (300)
+
+// Where a run was at its last checkpoint
+typedef struct checkpointProgress
+{
+    uint8_t             segment;
+    uint16_t            resumes;        // Times this run has been picked up after a reset
+    uint32_t            totalPulses;
+    uint32_t            segmentSeconds;
+    uint32_t            sequenceIndex;  // Coverage point or gated offset
+    workloadStats_t     stats;          // Active segment so far
+} checkpointProgress_t;
+
+bool Checkpoint_IsEnabled(void);
+bool Checkpoint_WasUnexpectedReset(void);
+void Checkpoint_Begin(const workloadSettings_t segments[], const workloadStats_t stats[], uint8_t numSegments, uint32_t pulseTarget);
+bool Checkpoint_Load(workloadSettings_t segments[], workloadStats_t stats[], uint8_t *numSegments, uint32_t *pulseTarget, checkpointProgress_t *progress);
+void Checkpoint_Continue(const workloadStats_t stats[]);
+bool Checkpoint_IsDue(uint32_t currentSeconds);
+void Checkpoint_Save(const checkpointProgress_t *progress, uint32_t currentSeconds);
+void Checkpoint_SegmentDone(uint8_t segment);
+void Checkpoint_Service(void);
+void Checkpoint_End(void);
+functionResult_e Checkpoint_Setup(unsigned int numArgs, int args[]);
+
+#endif // CHECKPOINT_H
\ No newline at end of file
@@ -26,18 +26,241 @@
 
 #include <conio.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "console.h"
 
-static consoleSettings_t *consoleSettings;
+static const consoleSettings_t *consoleSettings;
+// Callbacks get int arguments, the full value of each is kept here for the
+// ones that take 32 bits
+static uint32_t argValues[MAX_COMMAND_ARGS];
 
-static const consoleSelection_t splashOptions[] = {{'m',"menus"},{'o',"options"}};
+static const consoleSelection_t splashOptions[] = {{'m',"menus"},{'c',"command"},{'o',"options"}};
 static const consoleSelection_t menuOptions[] = {{'t',"top"},{'u',"up"},{'q',"quit"}};
 
-void Console_Init(consoleSettings_t *settings)
+// Menu items are selected with '0'-'9' and then 'A'-'Z'
+static char Console_IndexToKey(unsigned int index)
+{
+    return (index < 10) ? ('0' + index) : ('A' + (index - 10));
+}
+
+static unsigned int Console_KeyToIndex(char key)
+{
+    if ((key >= '0') && (key <= '9'))
+    {
+        return key - '0';
+    }
+    if ((key >= 'A') && (key <= 'Z'))
+    {
+        return key - 'A' + 10;
+    }
+    return MAX_MENU_ITEMS;
+}
+
+static bool Console_NameMatches(const char *name, const char *token)
+{
+    char a;
+    char b;
+
+    // Case insensitive compare
+    do
+    {
+        a = *name++;
+        b = *token++;
+        if ((a >= 'A') && (a <= 'Z'))
+        {
+            a += ('a' - 'A');
+        }
+        if ((b >= 'A') && (b <= 'Z'))
+        {
+            b += ('a' - 'A');
+        }
+        if (a != b)
+        {
+            return false;
+        }
+    }
+    while (a != 0);
+
+    return true;
+}
+
+static void Console_PrintCommands(const consoleMenu_t *menu)
+{
+    const consoleMenu_t *menuStack[MAX_MENU_DEPTH];
+    unsigned int indexStack[MAX_MENU_DEPTH];
+    unsigned int depth = 0;
+    unsigned int index = 0;
+    const consoleMenuItem_t *menuItem;
+
+    Console_Print("Commands (arguments are optional, missing ones are prompted for):");
+    // Walk the menu tree without recursion, XC8 doesn't do reentrant well
+    for (;;)
+    {
+        if (index >= menu->menuLength)
+        {
+            if (depth == 0)
+            {
+                break;
+            }
+            depth--;
+            menu = menuStack[depth];
+            index = indexStack[depth] + 1;
+            continue;
+        }
+        menuItem = &(menu->menuItems[index]);
+        if ((menuItem->subMenu != NO_SUB_MENU) && (depth < MAX_MENU_DEPTH))
+        {
+            menuStack[depth] = menu;
+            indexStack[depth] = index;
+            depth++;
+            menu = menuItem->subMenu;
+            index = 0;
+            continue;
+        }
+        Console_PrintNoEol(" ");
+        for (unsigned int i = 0; i < depth; i++)
+        {
+            Console_PrintNoEol(" %s", menuStack[i]->menuItems[indexStack[i]].id.name);
+        }
+        Console_Print(" "ANSI_COLOR_YELLOW"%s"ANSI_COLOR_RESET" - %s", menuItem->id.name, menuItem->id.description);
+        index++;
+    }
+    Console_Print(" "ANSI_COLOR_YELLOW"help"ANSI_COLOR_RESET" - Show this list");
+    Console_Print(" "ANSI_COLOR_YELLOW"quit"ANSI_COLOR_RESET" - Leave command mode");
+}
+
+// Decimal only, so a leading zero isn't octal, and the whole token has to
+// be a number
+static bool Console_ParseArgument(const char *token, int *value, uint32_t *longValue)
+{
+    bool negative = (*token == '-');
+    uint32_t result = 0;
+
+    if (negative)
+    {
+        token++;
+    }
+    if (*token == 0)
+    {
+        return false;
+    }
+    for (; *token != 0; token++)
+    {
+        if ((*token < '0') || (*token > '9'))
+        {
+            return false;
+        }
+        if (result > ((UINT32_MAX - (uint8_t)(*token - '0')) / 10))
+        {
+            return false;
+        }
+        result = (result * 10) + (uint8_t)(*token - '0');
+    }
+    // Negative ones only go to int arguments. Positive ones too big for an
+    // int are only good for Console_ArgOrPromptForLong.
+    if (negative && (result > 32768))
+    {
+        return false;
+    }
+    *value = negative ? (int)(0 - result) : ((result > UINT16_MAX) ? 0 : (int)result);
+    *longValue = negative ? 0 : result;
+
+    return true;
+}
+
+static void Console_DispatchCommand(const consoleMenu_t *menu, char *line)
+{
+    char *tokens[MAX_COMMAND_TOKENS];
+    unsigned int numTokens = 0;
+    int args[MAX_COMMAND_ARGS];
+    unsigned int numArgs = 0;
+    unsigned int token = 0;
+    const consoleMenuItem_t *menuItem = NO_SUB_MENU;
+    functionResult_e result;
+
+    // Split on whitespace in place
+    while (*line != 0)
+    {
+        while (*line == ' ')
+        {
+            *line++ = 0;
+        }
+        if (*line == 0)
+        {
+            break;
+        }
+        if (numTokens == MAX_COMMAND_TOKENS)
+        {
+            Console_Print(ANSI_COLOR_RED" Too many arguments!"ANSI_COLOR_RESET);
+            return;
+        }
+        tokens[numTokens++] = line;
+        while ((*line != ' ') && (*line != 0))
+        {
+            line++;
+        }
+    }
+    if (numTokens == 0)
+    {
+        return;
+    }
+
+    // Walk down submenus until we hit something we can run
+    while (token < numTokens)
+    {
+        menuItem = NO_SUB_MENU;
+        for (unsigned int i = 0; i < menu->menuLength; i++)
+        {
+            if (Console_NameMatches(menu->menuItems[i].id.name, tokens[token]))
+            {
+                menuItem = &(menu->menuItems[i]);
+                break;
+            }
+        }
+        token++;
+        if (menuItem == NO_SUB_MENU)
+        {
+            Console_Print(ANSI_COLOR_RED" Unknown command '%s', try help"ANSI_COLOR_RESET, tokens[token - 1]);
+            return;
+        }
+        if (menuItem->subMenu == NO_SUB_MENU)
+        {
+            break;
+        }
+        menu = menuItem->subMenu;
+    }
+    if ((menuItem->subMenu != NO_SUB_MENU) || (menuItem->functionPointer == NO_FUNCTION_POINTER))
+    {
+        Console_PrintMenu(menu);
+        return;
+    }
+
+    // Everything left over is an argument
+    for (; token < numTokens; token++)
+    {
+        if (numArgs == MAX_COMMAND_ARGS)
+        {
+            Console_Print(ANSI_COLOR_RED" Too many arguments!"ANSI_COLOR_RESET);
+            return;
+        }
+        if (!Console_ParseArgument(tokens[token], &args[numArgs], &argValues[numArgs]))
+        {
+            Console_Print(ANSI_COLOR_RED" Bad argument '%s'!"ANSI_COLOR_RESET, tokens[token]);
+            return;
+        }
+        numArgs++;
+    }
+
+    result = menuItem->functionPointer(numArgs, args);
+    Console_Print("%s", (result == SUCCESS) ? ANSI_COLOR_GREEN"ok"ANSI_COLOR_RESET : ANSI_COLOR_RED"error"ANSI_COLOR_RESET);
+}
+
+void Console_Init(const consoleSettings_t *settings)
 {
     consoleSettings = settings;
 }
@@ -62,6 +285,9 @@ void Console_Main(void)
             case 'm':
                 Console_TraverseMenus(consoleSettings->mainMenuPointer);
                 break;
+            case 'c':
+                Console_CommandLine(consoleSettings->mainMenuPointer);
+                break;
             case 'o':
                 Console_Print(ANSI_COLOR_RED" Options not implemented."ANSI_COLOR_RESET);
                 break;
@@ -84,6 +310,104 @@ unsigned int Console_PromptForInt(const char *prompt)
     return input;
 }
 
+unsigned int Console_ArgOrPromptForInt(unsigned int numArgs, int args[], unsigned int index, const char *prompt)
+{
+    if (index < numArgs)
+    {
+        // Never cut a big one down, ask for it again
+        if (argValues[index] <= UINT16_MAX)
+        {
+            return (unsigned int)args[index];
+        }
+        Console_Print(ANSI_COLOR_RED" Argument %u is over 65535!"ANSI_COLOR_RESET, index + 1);
+    }
+
+    return Console_PromptForInt(prompt);
+}
+
+uint32_t Console_PromptForLong(const char *prompt)
+{
+    char input[12];
+
+    // scanf only handles int, which is 16 bits on this part
+    Console_PrintNoEol("%s ", prompt);
+    Console_ReadLine(input, sizeof(input));
+
+    return strtoul(input, NULL, 10);
+}
+
+uint32_t Console_ArgOrPromptForLong(unsigned int numArgs, int args[], unsigned int index, const char *prompt)
+{
+    if (index < numArgs)
+    {
+        // Only negative arguments leave their full value at zero
+        if ((argValues[index] != 0) || (args[index] == 0))
+        {
+            return argValues[index];
+        }
+        Console_Print(ANSI_COLOR_RED" Argument %u can't be negative!"ANSI_COLOR_RESET, index + 1);
+    }
+
+    return Console_PromptForLong(prompt);
+}
+
+unsigned int Console_ReadLine(char *buffer, unsigned int bufferLength)
+{
+    unsigned int length = 0;
+    char c;
+
+    for (;;)
+    {
+        c = getch();
+        if (c == '\r')
+        {
+            break;
+        }
+        else if ((c == '\b') || (c == 0x7F))
+        {
+            if (length > 0)
+            {
+                length--;
+                Console_PrintNoEol("\b \b");
+            }
+        }
+        else if ((length < (bufferLength - 1)) && (c >= ' '))
+        {
+            buffer[length++] = c;
+            Console_PutChar(c);
+        }
+    }
+    buffer[length] = 0;
+    Console_PrintNewLine();
+
+    return length;
+}
+
+void Console_CommandLine(const consoleMenu_t *menu)
+{
+    static char line[MAX_COMMAND_LINE_LENGTH];
+
+    Console_PrintHeader("Command Mode");
+    Console_Print(" Type help for a list of commands, quit to leave.");
+    for (;;)
+    {
+        Console_PrintNoEol(ANSI_COLOR_YELLOW"> "ANSI_COLOR_RESET);
+        Console_ReadLine(line, sizeof(line));
+        if (Console_NameMatches("quit", line) || Console_NameMatches("exit", line))
+        {
+            break;
+        }
+        else if (Console_NameMatches("help", line) || Console_NameMatches("?", line))
+        {
+            Console_PrintCommands(menu);
+        }
+        else
+        {
+            Console_DispatchCommand(menu, line);
+        }
+    }
+}
+
 void Console_PromptForAnyKeyBlocking(void)
 {
     Console_Print("Press any key to continue");
@@ -102,10 +426,10 @@ char Console_CheckForKey(void)
     }
 }
 
-void Console_TraverseMenus(consoleMenu_t *menu)
+void Console_TraverseMenus(const consoleMenu_t *menu)
 {
     bool stayPut = true;;
-    consoleMenu_t *currentMenu = menu;
+    const consoleMenu_t *currentMenu = menu;
     char selection;
     
     do
@@ -114,17 +438,19 @@ void Console_TraverseMenus(consoleMenu_t *menu)
         selection = Console_PrintOptionsAndGetResponse(menuOptions, SELECTION_SIZE(menuOptions), currentMenu->menuLength);
 
         // First check if it's a menu selection (selection should be valid)
-        if (selection <= '9')
+        if (Console_KeyToIndex(selection) < currentMenu->menuLength)
         {
+            unsigned int index = Console_KeyToIndex(selection);
+
             // Check if we have a submenu
-            if (currentMenu->menuItems[(selection-'0')].subMenu != NO_SUB_MENU)
+            if (currentMenu->menuItems[index].subMenu != NO_SUB_MENU)
             {
-                currentMenu = currentMenu->menuItems[(selection-'0')].subMenu;
+                currentMenu = currentMenu->menuItems[index].subMenu;
             }
             // Check if we have a function pointer
-            else if (currentMenu->menuItems[(selection-'0')].functionPointer != NO_FUNCTION_POINTER)
+            else if (currentMenu->menuItems[index].functionPointer != NO_FUNCTION_POINTER)
             {
-                currentMenu->menuItems[(selection-'0')].functionPointer(NO_ARGS, NO_ARGS);
+                currentMenu->menuItems[index].functionPointer(NO_ARGS, NO_ARGS);
                 // We stay put after executing a function
                 // ToDo: Print function return status
             }
@@ -169,7 +495,6 @@ void Console_TraverseMenus(consoleMenu_t *menu)
 
 char Console_PrintOptionsAndGetResponse(const consoleSelection_t selections[], unsigned int numSelections, unsigned int numMenuSelections)
 {
-    // ToDo: Assert on number of menu selections greater than 10
     char c;
     bool valid = false;
     
@@ -179,7 +504,7 @@ char Console_PrintOptionsAndGetResponse(const consoleSelection_t selections[], u
         // Print menu selections (these will override any conflicting passed in selections)
         if (numMenuSelections != 0)
         {
-            Console_PrintNoEol(" ["ANSI_COLOR_YELLOW"0"ANSI_COLOR_RESET"-"ANSI_COLOR_YELLOW"%c"ANSI_COLOR_RESET"]-item ", ('0' + (numMenuSelections - 1)));
+            Console_PrintNoEol(" ["ANSI_COLOR_YELLOW"0"ANSI_COLOR_RESET"-"ANSI_COLOR_YELLOW"%c"ANSI_COLOR_RESET"]-item ", Console_IndexToKey(numMenuSelections - 1));
         }
         // Print passed in selections
         for (int i = 0; i < numSelections; i++)
@@ -195,7 +520,7 @@ char Console_PrintOptionsAndGetResponse(const consoleSelection_t selections[], u
         if (numMenuSelections != 0)
         {
             // Check if it's a valid menu selection
-            if ((c - '0') < numMenuSelections)
+            if (Console_KeyToIndex(c) < numMenuSelections)
             {
                 valid = true;
             }
@@ -257,7 +582,7 @@ void Console_PrintNewLine(void)
     Console_PutChar('\n');
 }
 
-void Console_PrintHeader(char *headerString)
+void Console_PrintHeader(const char *headerString)
 {
     unsigned int stringLength = strlen(headerString);
 
@@ -284,7 +609,7 @@ void Console_PrintDivider(void)
     Console_PrintNewLine();
 }
 
-void Console_PrintMenu(consoleMenu_t *menu)
+void Console_PrintMenu(const consoleMenu_t *menu)
 {
     Console_PrintNewLine();
     Console_PrintHeader(menu->id.name);
@@ -293,8 +618,8 @@ void Console_PrintMenu(consoleMenu_t *menu)
     Console_PrintNewLine();
     for (int i = 0; i < menu->menuLength; i++)
     {
-        consoleMenuItem_t *menuItem = &(menu->menuItems[i]);
-        Console_Print(" ["ANSI_COLOR_YELLOW"%c"ANSI_COLOR_RESET"] %s - %s", '0' + i, menuItem->id.name, menuItem->id.description);
+        const consoleMenuItem_t *menuItem = &(menu->menuItems[i]);
+        Console_Print(" ["ANSI_COLOR_YELLOW"%c"ANSI_COLOR_RESET"] %s - %s", Console_IndexToKey(i), menuItem->id.name, menuItem->id.description);
     }
     Console_PrintNewLine();
 }
\ No newline at end of file
@@ -25,6 +25,8 @@
 #ifndef CONSOLE_H
 #define CONSOLE_H
 
+#include <stdint.h>
+
 // Console ANSI colors
 #define ANSI_COLOR_RED     "\x1b[31m"
 #define ANSI_COLOR_GREEN   "\x1b[32m"
@@ -45,11 +47,14 @@ typedef enum
 #define NO_SUB_MENU                 (0) // NULL
 #define NO_FUNCTION_POINTER         (0) // NULL
 #define NO_ARGS                     (0) // NULL
-#define MAX_MENU_NAME_LENGTH        (16)
-#define MAX_MENU_DESCRIPTION_LENGTH (48)
 #define CONSOLE_WIDTH               (80)
 #define HEADER_TITLE_EXTRAS_WIDTH   (6) // "=[  ]=" = 6 characters
 #define MAX_HEADER_TITLE_WIDTH      (CONSOLE_WIDTH - HEADER_TITLE_EXTRAS_WIDTH) 
+#define MAX_MENU_ITEMS              (36) // '0'-'9' then 'A'-'Z'
+#define MAX_COMMAND_LINE_LENGTH     (64)
+#define MAX_COMMAND_TOKENS          (12)
+#define MAX_COMMAND_ARGS            (11)
+#define MAX_MENU_DEPTH              (4)
 
 #define MENU_SIZE(x)                sizeof(x)/sizeof(consoleMenuItem_t)
 #define SELECTION_SIZE(x)           sizeof(x)/sizeof(consoleSelection_t)
@@ -57,25 +62,27 @@ typedef enum
 // User should define a splash screen as an as array of const pointer to const char.
 typedef const char *const splash_t[];
 
+// Menus are declared const so XC8 leaves them and their strings in program
+// memory, the whole tree costs no RAM. Only pointers go in the records.
 typedef struct consoleMenuId
 {
-    char                name[MAX_MENU_NAME_LENGTH];
-    char                description[MAX_MENU_DESCRIPTION_LENGTH];
+    const char          *name;
+    const char          *description;
 } consoleMenuId_t;
 
 typedef struct consoleMenuItem
 {
-    consoleMenuId_t     id;
-    struct consoleMenu  *subMenu;
-    functionResult_e    (*functionPointer)(unsigned int, int[]);
+    consoleMenuId_t             id;
+    const struct consoleMenu    *subMenu;
+    functionResult_e            (*functionPointer)(unsigned int, int[]);
 } consoleMenuItem_t;
 
 typedef struct consoleMenu
 {
-    consoleMenuId_t     id;
-    consoleMenuItem_t   *menuItems;
-    struct consoleMenu  *topMenu;
-    unsigned int        menuLength;
+    consoleMenuId_t             id;
+    const consoleMenuItem_t     *menuItems;
+    const struct consoleMenu    *topMenu;
+    uint8_t                     menuLength;     // Up to MAX_MENU_ITEMS
 } consoleMenu_t;
 
 typedef struct consoleSelection
@@ -90,22 +97,28 @@ typedef struct consoleSettings
     splash_t            *splashScreenPointer;
     unsigned int        numSplashLines;
     // Pointer to the main menu
-    consoleMenu_t       *mainMenuPointer;
+    const consoleMenu_t *mainMenuPointer;
 } consoleSettings_t;
 
-void Console_Init(consoleSettings_t *settings);
+void Console_Init(const consoleSettings_t *settings);
 void Console_Main(void);
 
 void Console_PromptForAnyKeyBlocking(void);
 char Console_CheckForKey(void);
 unsigned int Console_PromptForInt(const char *prompt);
-void Console_TraverseMenus(consoleMenu_t *menu);
+unsigned int Console_ArgOrPromptForInt(unsigned int numArgs, int args[], unsigned int index, const char *prompt);
+uint32_t Console_PromptForLong(const char *prompt);
+uint32_t Console_ArgOrPromptForLong(unsigned int numArgs, int args[], unsigned int index, const char *prompt);
+unsigned int Console_ReadLine(char *buffer, unsigned int bufferLength);
+void Console_CommandLine(const consoleMenu_t *menu);
+void Console_TraverseMenus(const consoleMenu_t *menu);
 char Console_PrintOptionsAndGetResponse(const consoleSelection_t selections[], unsigned int numSelections, unsigned int numMenuSelections);
+void Console_PutChar(char c);
 void Console_Print(const char *format, ...);
 void Console_PrintNoEol(const char *format, ...);
 void Console_PrintNewLine(void);
-void Console_PrintHeader(char *headerString);
+void Console_PrintHeader(const char *headerString);
 void Console_PrintDivider(void);
-void Console_PrintMenu(consoleMenu_t *menu);
+void Console_PrintMenu(const consoleMenu_t *menu);
 
 #endif // CONSOLE_H
\ No newline at end of file
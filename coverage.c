@@ -0,0 +1,167 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "utils.h"
+#include "calibration.h"
+#include "coverage.h"
+
+#define COVERAGE_QUEUE_MASK     (COVERAGE_QUEUE_SIZE - 1)
+
+volatile bool coverageActive;
+
+// Range in Timer3 ticks
+static uint16_t minimumTicks;
+static uint16_t rangeTicks;
+// Index of the next point to queue
+static uint32_t nextIndex;
+
+// Filled by Coverage_Service, drained by the compare interrupt
+static volatile uint16_t queue[COVERAGE_QUEUE_SIZE];
+static volatile uint8_t queueHead;
+static volatile uint8_t queueTail;
+static volatile uint32_t usedIndex;     // Index of the period running now
+static volatile uint16_t usedTicks;
+static volatile uint16_t underruns;
+
+static uint16_t Coverage_Point(uint32_t index)
+{
+    // 0 to rangeTicks without a 32-bit modulo
+    return minimumTicks + (uint16_t)((((uint32_t)rangeTicks + 1) * Util_VanDerCorput(index)) >> 16);
+}
+
+// Returns the period to start the comparator with, in us
+uint16_t Coverage_Start(uint16_t startPeriod, uint16_t endPeriod, uint32_t startIndex)
+{
+    uint16_t swap;
+
+    if (startPeriod > endPeriod)
+    {
+        swap = startPeriod;
+        startPeriod = endPeriod;
+        endPeriod = swap;
+    }
+    minimumTicks = Calibration_PeriodToTicks(startPeriod);
+    rangeTicks = Calibration_PeriodToTicks(endPeriod) - minimumTicks;
+    underruns = 0;
+    coverageActive = true;
+
+    return Coverage_SetIndex(startIndex);
+}
+
+// Only while the comparator is off. Returns the period to start it with.
+uint16_t Coverage_SetIndex(uint32_t index)
+{
+    usedIndex = index;
+    usedTicks = Coverage_Point(index);
+    nextIndex = index + 1;
+    queueHead = 0;
+    queueTail = 0;
+    Coverage_Service();
+
+    return (uint16_t)(((uint32_t)usedTicks * 2) / 3);
+}
+
+// Keeps the queue topped up
+void Coverage_Service(void)
+{
+    uint8_t next;
+
+    for (;;)
+    {
+        next = (queueHead + 1) & COVERAGE_QUEUE_MASK;
+        if (next == queueTail)
+        {
+            break;
+        }
+        queue[queueHead] = Coverage_Point(nextIndex);
+        nextIndex++;
+        queueHead = next;
+    }
+}
+
+void Coverage_Stop(void)
+{
+    coverageActive = false;
+}
+
+// Points used so far, where to pick up from next time
+uint32_t Coverage_GetIndex(void)
+{
+    bool interruptEnabled;
+    uint32_t index;
+
+    interruptEnabled = PIE1bits.CCP1IE;
+    PIE1bits.CCP1IE = 0;
+    index = usedIndex;
+    PIE1bits.CCP1IE = interruptEnabled;
+
+    return index;
+}
+
+// Period running now, in us
+uint16_t Coverage_GetPeriod(void)
+{
+    bool interruptEnabled;
+    uint16_t ticks;
+
+    interruptEnabled = PIE1bits.CCP1IE;
+    PIE1bits.CCP1IE = 0;
+    ticks = usedTicks;
+    PIE1bits.CCP1IE = interruptEnabled;
+
+    return (uint16_t)(((uint32_t)ticks * 2) / 3);
+}
+
+// Matches where the queue had run dry and the last period was repeated
+uint16_t Coverage_GetUnderruns(void)
+{
+    bool interruptEnabled;
+    uint16_t count;
+
+    interruptEnabled = PIE1bits.CCP1IE;
+    PIE1bits.CCP1IE = 0;
+    count = underruns;
+    PIE1bits.CCP1IE = interruptEnabled;
+
+    return count;
+}
+
+// Called on every ECCP1 match while a coverage workload runs. TMR3 was just
+// reset so CCPR1 is loaded with the period now starting.
+void Coverage_CompareIsr(void)
+{
+    if (queueTail == queueHead)
+    {
+        underruns++;
+        return;
+    }
+    usedTicks = queue[queueTail];
+    CCPR1 = usedTicks;
+    queueTail = (queueTail + 1) & COVERAGE_QUEUE_MASK;
+    usedIndex++;
+}
\ No newline at end of file
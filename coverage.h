@@ -0,0 +1,51 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Coverage workloads give every pulse its own period, drawn from the van
+// der Corput sequence over the start to end period range. Each new point
+// lands in the biggest gap left by the ones before it, so the range is
+// covered evenly after any number of pulses instead of only at the end of
+// a full ramp. Points are worked out in the main loop and queued for the
+// compare interrupt. The index is the number of points used, a campaign
+// carries on from it after a reset or when it's given as the start index.
+#define COVERAGE_QUEUE_SIZE     (8)     // Power of two
+
+extern volatile bool coverageActive;
+
+uint16_t Coverage_Start(uint16_t startPeriod, uint16_t endPeriod, uint32_t startIndex);
+uint16_t Coverage_SetIndex(uint32_t index);
+void Coverage_Service(void);
+void Coverage_Stop(void);
+uint32_t Coverage_GetIndex(void);
+uint16_t Coverage_GetPeriod(void);
+uint16_t Coverage_GetUnderruns(void);
+void Coverage_CompareIsr(void);
+
+#endif // COVERAGE_H
\ No newline at end of file
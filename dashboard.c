@@ -0,0 +1,244 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <conio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+#include "utils.h"
+#include "dashboard.h"
+
+#define DASHBOARD_FIRST_ROW         (3)
+#define DASHBOARD_VALUE_COLUMN      (20)
+#define DASHBOARD_VALUE_WIDTH       (11)    // Sign and ten digits
+// Credit is kept in byte-microseconds, a byte costs this much
+#define DASHBOARD_BYTE_COST         (MICROSECONDS_IN_SECONDS)
+// Credit never piles up past a quarter second of budget, or one update if
+// that's more
+#define DASHBOARD_MAX_CREDIT_TIME   (MICROSECONDS_IN_SECONDS / 4)
+// "\x1b[rr;ccH" plus the value
+#define DASHBOARD_MAX_UPDATE_LENGTH (8 + DASHBOARD_VALUE_WIDTH)
+
+static const char *const fieldLabels[NUM_DASHBOARD_FIELDS] =
+{
+    "Segment",
+    "Period (us)",
+    "Step",
+    "Elapsed (s)",
+    "Remaining (s)",
+    "Pulses",
+    "Count error",
+    "Sync skew (us)",
+};
+
+static bool dashboardEnabled;
+static uint16_t byteBudget = DASHBOARD_DEFAULT_BUDGET;
+
+static int32_t values[NUM_DASHBOARD_FIELDS];
+static int32_t sentValues[NUM_DASHBOARD_FIELDS];
+static bool fieldSent[NUM_DASHBOARD_FIELDS];
+static uint8_t nextField;
+static uint32_t credit;
+static uint32_t maxCredit;
+static uint32_t lastServiceTime;
+
+// Update currently being shifted out
+static char update[DASHBOARD_MAX_UPDATE_LENGTH];
+static uint8_t updateLength;
+static uint8_t updateIndex;
+
+static uint8_t Dashboard_PutNumber(char *buffer, uint32_t number)
+{
+    char digits[10];
+    uint8_t count = 0;
+    uint8_t length = 0;
+
+    do
+    {
+        digits[count++] = '0' + (number % 10);
+        number /= 10;
+    }
+    while (number != 0);
+    while (count != 0)
+    {
+        buffer[length++] = digits[--count];
+    }
+
+    return length;
+}
+
+// Cursor to the field then the value right justified, no printf so it's
+// cheap enough to do from the workload loop
+static void Dashboard_BuildUpdate(uint8_t field, int32_t value)
+{
+    char number[DASHBOARD_VALUE_WIDTH];
+    uint8_t numberLength = 0;
+    uint32_t magnitude = (value < 0) ? (uint32_t)(-value) : (uint32_t)value;
+
+    updateLength = 0;
+    update[updateLength++] = '\x1b';
+    update[updateLength++] = '[';
+    updateLength += Dashboard_PutNumber(&update[updateLength], DASHBOARD_FIRST_ROW + field);
+    update[updateLength++] = ';';
+    updateLength += Dashboard_PutNumber(&update[updateLength], DASHBOARD_VALUE_COLUMN);
+    update[updateLength++] = 'H';
+
+    if (value < 0)
+    {
+        number[numberLength++] = '-';
+    }
+    numberLength += Dashboard_PutNumber(&number[numberLength], magnitude);
+    for (uint8_t i = numberLength; i < DASHBOARD_VALUE_WIDTH; i++)
+    {
+        update[updateLength++] = ' ';
+    }
+    for (uint8_t i = 0; i < numberLength; i++)
+    {
+        update[updateLength++] = number[i];
+    }
+    updateIndex = 0;
+}
+
+bool Dashboard_IsEnabled(void)
+{
+    return dashboardEnabled;
+}
+
+void Dashboard_Start(uint32_t currentTime)
+{
+    // The frame is drawn once, only the values change after this
+    Console_Print(ERASE_SCREEN);
+    Console_PrintNoEol("\x1b[1;1H");
+    Console_Print(ANSI_COLOR_CYAN"Workload running, press any key to stop"ANSI_COLOR_RESET);
+    for (uint8_t i = 0; i < NUM_DASHBOARD_FIELDS; i++)
+    {
+        Console_PrintNoEol("\x1b[%d;1H%s", DASHBOARD_FIRST_ROW + i, fieldLabels[i]);
+        fieldSent[i] = false;
+    }
+    nextField = 0;
+    credit = 0;
+    // Small budgets would otherwise never save up enough to send anything
+    maxCredit = (uint32_t)DASHBOARD_MAX_CREDIT_TIME * byteBudget;
+    if (maxCredit < ((uint32_t)DASHBOARD_MAX_UPDATE_LENGTH * DASHBOARD_BYTE_COST))
+    {
+        maxCredit = (uint32_t)DASHBOARD_MAX_UPDATE_LENGTH * DASHBOARD_BYTE_COST;
+    }
+    lastServiceTime = currentTime;
+    updateLength = 0;
+    updateIndex = 0;
+}
+
+void Dashboard_Set(dashboardField_e field, int32_t value)
+{
+    values[field] = value;
+}
+
+void Dashboard_Service(uint32_t currentTime)
+{
+    uint32_t elapsed = currentTime - lastServiceTime;
+    uint8_t field;
+
+    // Top up the credit for the time that's gone by
+    lastServiceTime = currentTime;
+    if (elapsed > DASHBOARD_MAX_CREDIT_TIME)
+    {
+        elapsed = DASHBOARD_MAX_CREDIT_TIME;
+    }
+    credit += elapsed * byteBudget;
+    if (credit > maxCredit)
+    {
+        credit = maxCredit;
+    }
+
+    // Only ever load the transmit register when it's empty, never wait on it
+    while ((updateIndex < updateLength) && TXIF)
+    {
+        TXREG1 = update[updateIndex++];
+    }
+    if (updateIndex < updateLength)
+    {
+        return;
+    }
+
+    // Next field that changed since it was last sent, round robin so a
+    // busy field can't starve the others
+    for (uint8_t i = 0; i < NUM_DASHBOARD_FIELDS; i++)
+    {
+        field = nextField;
+        nextField = (nextField + 1) % NUM_DASHBOARD_FIELDS;
+        if (!fieldSent[field] || (values[field] != sentValues[field]))
+        {
+            Dashboard_BuildUpdate(field, values[field]);
+            if (credit < ((uint32_t)updateLength * DASHBOARD_BYTE_COST))
+            {
+                // Not enough budget yet, try this one again next time
+                updateLength = 0;
+                nextField = field;
+                return;
+            }
+            credit -= (uint32_t)updateLength * DASHBOARD_BYTE_COST;
+            sentValues[field] = values[field];
+            fieldSent[field] = true;
+            return;
+        }
+    }
+}
+
+void Dashboard_Stop(void)
+{
+    // Pulses are off by now, so it's safe to block until the update is out
+    while (updateIndex < updateLength)
+    {
+        putch(update[updateIndex++]);
+    }
+    // Park the cursor under the panel for the statistics
+    Console_Print("\x1b[%d;1H", DASHBOARD_FIRST_ROW + NUM_DASHBOARD_FIELDS + 1);
+}
+
+functionResult_e Dashboard_Setup(unsigned int numArgs, int args[])
+{
+    uint16_t budget;
+
+    Console_Print("Dashboard is currently %s with %u bytes/s", dashboardEnabled ? "on" : "off", byteBudget);
+    // Arguments: enable [budget]
+    dashboardEnabled = (Console_ArgOrPromptForInt(numArgs, args, 0, "Enable dashboard (0/1): ") != 0);
+    if (dashboardEnabled)
+    {
+        budget = Console_ArgOrPromptForInt(numArgs, args, 1, "Enter byte budget (bytes/s): ");
+        if (budget == 0)
+        {
+            budget = DASHBOARD_DEFAULT_BUDGET;
+        }
+        else if (budget > DASHBOARD_MAX_BUDGET)
+        {
+            Console_Print("Limiting budget to %d bytes/s, %d%% of the link", DASHBOARD_MAX_BUDGET, DASHBOARD_MAX_LINK_PERCENT);
+            budget = DASHBOARD_MAX_BUDGET;
+        }
+        byteBudget = budget;
+    }
+
+    return SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef DASHBOARD_H
+#define DASHBOARD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+
+// 115200 baud with 8N1 framing is 10 bits per byte on the wire
+#define DASHBOARD_LINK_BYTES_PER_SECOND (11520)
+// Most of the link stays free so commands and key presses get through
+#define DASHBOARD_MAX_LINK_PERCENT      (25)
+#define DASHBOARD_MAX_BUDGET            ((DASHBOARD_LINK_BYTES_PER_SECOND * DASHBOARD_MAX_LINK_PERCENT) / 100)
+#define DASHBOARD_DEFAULT_BUDGET        (1000)  // Bytes per second
+
+typedef enum
+{
+    DASHBOARD_FIELD_SEGMENT = 0,
+    DASHBOARD_FIELD_PERIOD,
+    DASHBOARD_FIELD_STEP,
+    DASHBOARD_FIELD_ELAPSED,
+    DASHBOARD_FIELD_REMAINING,
+    DASHBOARD_FIELD_PULSES,
+    DASHBOARD_FIELD_COUNT_ERROR,
+    DASHBOARD_FIELD_SYNC_SKEW,
+    NUM_DASHBOARD_FIELDS,
+} dashboardField_e;
+
+bool Dashboard_IsEnabled(void);
+void Dashboard_Start(uint32_t currentTime);
+void Dashboard_Set(dashboardField_e field, int32_t value);
+void Dashboard_Service(uint32_t currentTime);
+void Dashboard_Stop(void);
+functionResult_e Dashboard_Setup(unsigned int numArgs, int args[]);
+
+#endif // DASHBOARD_H
\ No newline at end of file
@@ -0,0 +1,149 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "utils.h"
+#include "calibration.h"
+#include "dds.h"
+
+// Tick rate of the phase accumulator (Timer2 match)
+#define DDS_TICKS_PER_MILLISECOND   (100)
+
+volatile uint32_t ddsPhase;
+volatile uint32_t ddsPhaseIncrement;
+volatile bool ddsActive;
+
+// Compare offset = (sample * depthScale) >> depthShift, keeps the interrupt
+// down to an 8x8 multiply and a shift
+static uint16_t centerTicks;
+static uint8_t depthScale;
+static uint8_t depthShift;
+static ddsWaveform_e ddsWaveform;
+static volatile uint16_t lastCompareTicks;
+
+// One cycle of sin(x) scaled to +/-127
+static const int8_t sineTable[256] =
+{
+    0, 3, 6, 9, 12, 16, 19, 22, 25, 28, 31, 34, 37, 40, 43, 46,
+    49, 51, 54, 57, 60, 63, 65, 68, 71, 73, 76, 78, 81, 83, 85, 88,
+    90, 92, 94, 96, 98, 100, 102, 104, 106, 107, 109, 111, 112, 113, 115, 116,
+    117, 118, 120, 121, 122, 122, 123, 124, 125, 125, 126, 126, 126, 127, 127, 127,
+    127, 127, 127, 127, 126, 126, 126, 125, 125, 124, 123, 122, 122, 121, 120, 118,
+    117, 116, 115, 113, 112, 111, 109, 107, 106, 104, 102, 100, 98, 96, 94, 92,
+    90, 88, 85, 83, 81, 78, 76, 73, 71, 68, 65, 63, 60, 57, 54, 51,
+    49, 46, 43, 40, 37, 34, 31, 28, 25, 22, 19, 16, 12, 9, 6, 3,
+    0, -3, -6, -9, -12, -16, -19, -22, -25, -28, -31, -34, -37, -40, -43, -46,
+    -49, -51, -54, -57, -60, -63, -65, -68, -71, -73, -76, -78, -81, -83, -85, -88,
+    -90, -92, -94, -96, -98, -100, -102, -104, -106, -107, -109, -111, -112, -113, -115, -116,
+    -117, -118, -120, -121, -122, -122, -123, -124, -125, -125, -126, -126, -126, -127, -127, -127,
+    -127, -127, -127, -127, -126, -126, -126, -125, -125, -124, -123, -122, -122, -121, -120, -118,
+    -117, -116, -115, -113, -112, -111, -109, -107, -106, -104, -102, -100, -98, -96, -94, -92,
+    -90, -88, -85, -83, -81, -78, -76, -73, -71, -68, -65, -63, -60, -57, -54, -51,
+    -49, -46, -43, -40, -37, -34, -31, -28, -25, -22, -19, -16, -12, -9, -6, -3,
+};
+
+void Dds_Start(uint16_t centerPeriod, uint16_t depth, uint16_t modulationPeriod, ddsWaveform_e waveform)
+{
+    // 2 us for every 3 ticks
+    uint32_t depthTicks = ((uint32_t)depth * 3)/2;
+    bool interruptEnabled;
+
+    centerTicks = Calibration_PeriodToTicks(centerPeriod);
+    // Never swing below zero or past the top of the timer
+    if (depthTicks >= centerTicks)
+    {
+        depthTicks = centerTicks - 1;
+    }
+    if ((centerTicks + depthTicks) > UINT16_MAX)
+    {
+        depthTicks = UINT16_MAX - centerTicks;
+    }
+    // Keep as much precision in the scale as we can
+    depthShift = 7;
+    while (((((depthTicks << depthShift) + 126) / 127) > UINT8_MAX) && (depthShift > 0))
+    {
+        depthShift--;
+    }
+    if ((((depthTicks << depthShift) + 126) / 127) > UINT8_MAX)
+    {
+        depthScale = UINT8_MAX;
+    }
+    else
+    {
+        depthScale = (uint8_t)(((depthTicks << depthShift) + 126) / 127);
+    }
+    ddsWaveform = waveform;
+    lastCompareTicks = centerTicks;
+
+    if (modulationPeriod == 0)
+    {
+        modulationPeriod = 1;
+    }
+    // Only the low priority tick writes the phase, pulses can carry on
+    interruptEnabled = INTCONbits.GIEL;
+    INTCONbits.GIEL = 0;
+    ddsPhase = 0;
+    ddsPhaseIncrement = UINT32_MAX / ((uint32_t)modulationPeriod * DDS_TICKS_PER_MILLISECOND);
+    ddsActive = true;
+    INTCONbits.GIEL = interruptEnabled;
+}
+
+void Dds_Stop(void)
+{
+    bool interruptEnabled;
+
+    interruptEnabled = INTCONbits.GIEL;
+    INTCONbits.GIEL = 0;
+    ddsActive = false;
+    ddsPhaseIncrement = 0;
+    INTCONbits.GIEL = interruptEnabled;
+}
+
+void Dds_CompareIsr(void)
+{
+    uint8_t index = (uint8_t)(ddsPhase >> 24);
+    int8_t sample;
+
+    if (ddsWaveform == DDS_WAVEFORM_SINE)
+    {
+        sample = sineTable[index];
+    }
+    else
+    {
+        // Falling ramp, long periods first like the sawtooth-down workload
+        sample = (int8_t)(0x7F - index);
+    }
+    // TMR3 was just reset by the special event, this sets the period now starting
+    lastCompareTicks = centerTicks + (((int16_t)sample * depthScale) >> depthShift);
+    CCPR1 = lastCompareTicks;
+}
+
+uint16_t Dds_GetPeriod(void)
+{
+    // 3 ticks for every 2 us
+    return (uint16_t)(((uint32_t)lastCompareTicks * 2)/3);
+}
\ No newline at end of file
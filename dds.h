@@ -0,0 +1,48 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef DDS_H
+#define DDS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum
+{
+    DDS_WAVEFORM_SINE = 0,
+    DDS_WAVEFORM_SAWTOOTH = 1,
+    NUM_DDS_WAVEFORMS,
+} ddsWaveform_e;
+
+// Phase accumulator, advanced every 10 us by the Timer2 tick
+extern volatile uint32_t ddsPhase;
+extern volatile uint32_t ddsPhaseIncrement;
+extern volatile bool ddsActive;
+
+void Dds_Start(uint16_t centerPeriod, uint16_t depth, uint16_t modulationPeriod, ddsWaveform_e waveform);
+void Dds_Stop(void);
+void Dds_CompareIsr(void);
+uint16_t Dds_GetPeriod(void);
+
+#endif // DDS_H
\ No newline at end of file
@@ -0,0 +1,130 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "utils.h"
+#include "flash.h"
+
+#define FLASH_WRITE_BUDGET_TICKS    ((FLASH_WRITE_BUDGET_US * 3) / 2)
+#define FLASH_ERASE_BUDGET_TICKS    ((uint16_t)((FLASH_ERASE_BUDGET_US * 3UL) / 2))
+
+static void Flash_SetTablePointer(uint16_t address)
+{
+    TBLPTRU = 0;
+    TBLPTRH = (uint8_t)(address >> 8);
+    TBLPTRL = (uint8_t)(address);
+}
+
+// Runs the erase or write already set up in EECON1. Returns false without
+// touching flash if the next compare match would land inside the stall.
+static bool Flash_Unlock(uint16_t budgetTicks)
+{
+    uint8_t interruptsEnabled;
+    uint16_t startTicks;
+    uint16_t stallTicks;
+    uint16_t lostTicks;
+
+    interruptsEnabled = INTCON & 0xC0;  // GIEH and GIEL
+    INTCONbits.GIEH = 0;
+    // Pulses are generated by the interrupt, which can't run while the CPU
+    // is stalled, so only go ahead if the next one is far enough away
+    if (Util_GetTicksToNextMatch() < budgetTicks)
+    {
+        EECON1bits.WREN = 0;
+        INTCON |= interruptsEnabled;
+        return false;
+    }
+    startTicks = TMR3;
+    EECON2 = 0x55;
+    EECON2 = 0xAA;
+    EECON1bits.WR = 1;      // 0b1 = Start the erase/write, the CPU stalls until it's done
+    stallTicks = TMR3 - startTicks;
+    EECON1bits.WREN = 0;
+    INTCON |= interruptsEnabled;
+
+    // Timer2 kept running but only one of the ticks that went by is still
+    // pending, make up the rest
+    lostTicks = (uint16_t)((((uint32_t)stallTicks * 2) / 3) / 10);
+    if (lostTicks > 1)
+    {
+        Util_AdvanceUptime(lostTicks - 1);
+    }
+
+    return true;
+}
+
+void Flash_Read(uint16_t address, void *data, uint16_t length)
+{
+    uint8_t *byte = (uint8_t *)data;
+
+    Flash_SetTablePointer(address);
+    while (length-- != 0)
+    {
+        asm("TBLRD*+");
+        *byte++ = TABLAT;
+    }
+}
+
+// Erases the FLASH_ERASE_BLOCK_SIZE block that address is in, if there's
+// time before the next pulse
+bool Flash_Erase(uint16_t address)
+{
+    Flash_SetTablePointer(address);
+    EECON1bits.WPROG = 0;   // 0b0 = Write the whole block, not just a word
+    EECON1bits.FREE = 1;    // 0b1 = Erase the block addressed by TBLPTR
+    EECON1bits.WREN = 1;    // 0b1 = Allow erase/write cycles
+
+    return Flash_Unlock(FLASH_ERASE_BUDGET_TICKS);
+}
+
+// Programs the FLASH_WRITE_BLOCK_SIZE block that address is in, anything
+// after length is left erased. The block has to have been erased first.
+bool Flash_Write(uint16_t address, const void *data, uint8_t length)
+{
+    const uint8_t *byte = (const uint8_t *)data;
+
+    // Fill the holding registers, the last TBLWT mustn't move the pointer
+    // out of the block or the write goes to the next one
+    Flash_SetTablePointer(address & ~(FLASH_WRITE_BLOCK_SIZE - 1));
+    for (uint8_t i = 0; i < FLASH_WRITE_BLOCK_SIZE; i++)
+    {
+        TABLAT = (i < length) ? byte[i] : 0xFF;
+        if (i < (FLASH_WRITE_BLOCK_SIZE - 1))
+        {
+            asm("TBLWT*+");
+        }
+        else
+        {
+            asm("TBLWT*");
+        }
+    }
+    EECON1bits.WPROG = 0;   // 0b0 = Write the whole block, not just a word
+    EECON1bits.FREE = 0;    // 0b0 = Write only
+    EECON1bits.WREN = 1;    // 0b1 = Allow erase/write cycles
+
+    return Flash_Unlock(FLASH_WRITE_BUDGET_TICKS);
+}
\ No newline at end of file
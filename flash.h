@@ -0,0 +1,44 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef FLASH_H
+#define FLASH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FLASH_ERASE_BLOCK_SIZE  (1024)
+#define FLASH_WRITE_BLOCK_SIZE  (64)
+// The CPU stalls for the whole erase or write, which also holds off the
+// compare interrupt. Only start one with at least this long to go before
+// the next pulse. Erasing takes ten times as long as writing, which is
+// longer than most periods, so it's best left for when pulses are off.
+#define FLASH_WRITE_BUDGET_US   (5000)      // 2.8 ms typical
+#define FLASH_ERASE_BUDGET_US   (40000)     // 33 ms typical
+
+void Flash_Read(uint16_t address, void *data, uint16_t length);
+bool Flash_Erase(uint16_t address);
+bool Flash_Write(uint16_t address, const void *data, uint8_t length);
+
+#endif // FLASH_H
\ No newline at end of file
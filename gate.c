@@ -0,0 +1,276 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+#include "utils.h"
+#include "gate.h"
+#include "glitch.h"
+
+volatile bool gateActive;
+
+// Busy level on RD2, 0 for an active-low line like R/B#
+static uint8_t busyLevel;
+
+// Settings for this segment, in Timer3 ticks
+static uint16_t minimumTicks;
+static uint16_t offsetRange;    // Ticks above the minimum, inclusive
+static uint16_t steps;
+static uint16_t holdoffMilliseconds;
+static gateOrder_e gateOrder;
+static uint16_t randomState = 0xACE1;
+
+// Main loop state, sweeps and coverage step through offsets by index
+static uint32_t sequenceIndex;  // Of the next offset to plan
+static bool waitingToArm;
+static bool holdingOff;
+static uint32_t holdoffStart;
+
+// Handed over between the interrupts and Gate_Service. Only one window is
+// in flight at a time, INT2 stays off until the last one is dealt with.
+static volatile uint16_t offsetTicks;
+static volatile bool windowDone;
+static volatile bool windowPulsed;
+
+// Run totals, over every gated segment
+static uint32_t windows;
+static uint32_t hits;
+static uint32_t misses;
+static uint16_t offsetMinimumHit;
+static uint16_t offsetMaximumHit;
+
+static uint16_t Gate_Random(void)
+{
+    // 16-bit xorshift
+    randomState ^= randomState << 7;
+    randomState ^= randomState >> 9;
+    randomState ^= randomState << 8;
+    return randomState;
+}
+
+static void Gate_PlanNext(void)
+{
+    uint16_t ticks;
+
+    if (gateOrder == GATE_ORDER_RANDOM)
+    {
+        // 0 to offsetRange without a 32-bit modulo
+        ticks = minimumTicks + (uint16_t)((((uint32_t)offsetRange + 1) * Gate_Random()) >> 16);
+    }
+    else if (gateOrder == GATE_ORDER_COVERAGE)
+    {
+        ticks = minimumTicks + (uint16_t)((((uint32_t)offsetRange + 1) * Util_VanDerCorput(sequenceIndex)) >> 16);
+    }
+    else
+    {
+        ticks = minimumTicks;
+        if (steps > 1)
+        {
+            ticks += (uint16_t)(((uint32_t)offsetRange * (sequenceIndex % steps)) / (steps - 1));
+        }
+    }
+    sequenceIndex++;
+    // The interrupt is off while waiting to arm, nothing else touches it
+    offsetTicks = ticks;
+}
+
+static void Gate_Arm(void)
+{
+    INTCON3bits.INT2IF = 0;
+    INTCON3bits.INT2IE = 1;     // Enable INT2 interrupt, off again at the next edge
+}
+
+void Gate_ClearStats(void)
+{
+    windows = 0;
+    hits = 0;
+    misses = 0;
+    offsetMinimumHit = UINT16_MAX;
+    offsetMaximumHit = 0;
+}
+
+// The comparator stays off until the first busy window
+void Gate_Start(uint16_t minimumOffset, uint16_t maximumOffset, uint16_t sweepSteps, uint16_t holdoff, gateOrder_e order, uint32_t startIndex)
+{
+    uint16_t maximumTicks;
+
+    if (minimumOffset < GATE_MIN_OFFSET_US)
+    {
+        minimumOffset = GATE_MIN_OFFSET_US;
+    }
+    if (maximumOffset < minimumOffset)
+    {
+        maximumOffset = minimumOffset;
+    }
+    minimumTicks = Util_MicrosecondsToTicks(minimumOffset);
+    maximumTicks = Util_MicrosecondsToTicks(maximumOffset);
+    offsetRange = maximumTicks - minimumTicks;
+    steps = (sweepSteps == 0) ? 1 : sweepSteps;
+    holdoffMilliseconds = holdoff;
+    gateOrder = order;
+    sequenceIndex = startIndex;
+
+    INTCON3bits.INT2IE = 0;
+    INTCON2bits.INTEDG2 = busyLevel;    // Interrupt on the edge into busy
+    windowDone = false;
+    waitingToArm = false;
+    holdingOff = false;
+    Gate_PlanNext();
+    gateActive = true;
+    Gate_Arm();
+}
+
+void Gate_Service(void)
+{
+    if (windowDone)
+    {
+        windowDone = false;
+        windows++;
+        if (windowPulsed)
+        {
+            hits++;
+            if (offsetTicks < offsetMinimumHit)
+            {
+                offsetMinimumHit = offsetTicks;
+            }
+            if (offsetTicks > offsetMaximumHit)
+            {
+                offsetMaximumHit = offsetTicks;
+            }
+            // The DUT's busy line can do anything while it loses power and
+            // boots back up
+            holdingOff = true;
+            holdoffStart = Util_GetMillisecondUptime();
+        }
+        else
+        {
+            misses++;
+        }
+        Gate_PlanNext();
+        waitingToArm = true;
+    }
+
+    if (holdingOff && ((Util_GetMillisecondUptime() - holdoffStart) >= holdoffMilliseconds))
+    {
+        holdingOff = false;
+    }
+    // A glitch pattern still playing has the comparator
+    if (waitingToArm && !holdingOff && gateActive && !glitchPlaying)
+    {
+        waitingToArm = false;
+        Gate_Arm();
+    }
+}
+
+void Gate_Stop(void)
+{
+    INTCON3bits.INT2IE = 0;
+    gateActive = false;
+    // Count a window that was in flight
+    Gate_Service();
+}
+
+// Picks the offsets up from index, for resuming a campaign
+void Gate_SetIndex(uint32_t index)
+{
+    bool interruptEnabled;
+
+    interruptEnabled = INTCON3bits.INT2IE;
+    INTCON3bits.INT2IE = 0;
+    sequenceIndex = index;
+    Gate_PlanNext();
+    INTCON3bits.INT2IE = interruptEnabled;
+}
+
+// Index of the offset waiting for the next window
+uint32_t Gate_GetIndex(void)
+{
+    return sequenceIndex - 1;
+}
+
+uint32_t Gate_GetHits(void)
+{
+    return hits;
+}
+
+// Offset the next window will be pulsed at, in us
+uint16_t Gate_GetOffset(void)
+{
+    return (uint16_t)(((uint32_t)offsetTicks * 2) / 3);
+}
+
+void Gate_PrintStats(void)
+{
+    if (windows == 0)
+    {
+        return;
+    }
+    Console_Print("Busy windows:    %10lu", windows);
+    Console_Print("Pulsed in busy:  %10lu (%u%%)", hits, (uint16_t)((hits * 100) / windows));
+    Console_Print("Ended too soon:  %10lu", misses);
+    if (hits != 0)
+    {
+        Console_Print("Offsets hit:     %10u to %u us", (uint16_t)(((uint32_t)offsetMinimumHit * 2) / 3), (uint16_t)(((uint32_t)offsetMaximumHit * 2) / 3));
+    }
+    if (misses > hits)
+    {
+        Console_Print(ANSI_COLOR_YELLOW" Most windows are shorter than the offsets, try a smaller range"ANSI_COLOR_RESET);
+    }
+}
+
+// Called from the INT2 interrupt at the start of a busy window. TMR3 is
+// read first thing so the offset counts from as close to the edge as we
+// can get. The comparator is off between windows, so TMR3 is free running.
+void Gate_BusyEdgeIsr(void)
+{
+    uint16_t now = TMR3;
+
+    INTCON3bits.INT2IE = 0;     // One pulse per window
+    CCPR1 = now + offsetTicks;
+    CCP1CONbits.CCP1M = 0xB;    // 0b1011 = Compare mode, trigger special event (ECCPx resets TMR1 or TMR3, starts A/D conversion, sets CCxIF bit)
+}
+
+// Called on the ECCP1 match a window scheduled. Returns whether to pulse,
+// which is only if the DUT is still busy.
+bool Gate_CompareIsr(void)
+{
+    CCP1CONbits.CCP1M = 0x0;    // 0b0000 = Capture/Compare/PWM off, nothing to match until the next window
+    windowPulsed = (PORTDbits.RD2 == busyLevel);
+    windowDone = true;
+
+    return windowPulsed;
+}
+
+functionResult_e Gate_Setup(unsigned int numArgs, int args[])
+{
+    Console_Print("The DUT busy line on RD2 is currently active %s", (busyLevel != 0) ? "high" : "low");
+    // Arguments: level
+    busyLevel = (Console_ArgOrPromptForInt(numArgs, args, 0, "Enter busy level (0 = low like R/B#, 1 = high): ") != 0) ? 1 : 0;
+    Console_Print("Gated workloads pulse while RD2 is %s", (busyLevel != 0) ? "high" : "low");
+
+    return SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef GATE_H
+#define GATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+
+// Gated workloads only cut power while the DUT says it's busy, e.g. a NAND
+// R/B# line or an activity LED, wired to RD2 and taken in on INT2 through
+// RP19. The start of each busy window schedules one compare match at an
+// offset into it, picked at random, swept across a range or drawn from the
+// van der Corput sequence so the range fills in evenly. If the window
+// is over by the time the match comes around there's no pulse. After a
+// pulse, edges are ignored for a holdoff while the DUT comes back up.
+
+// Gives the interrupt time to finish with the edge before the match
+#define GATE_MIN_OFFSET_US      (20)
+
+typedef enum
+{
+    GATE_ORDER_RANDOM = 0,
+    GATE_ORDER_SWEEP,
+    GATE_ORDER_COVERAGE,
+    NUM_GATE_ORDERS
+} gateOrder_e;
+
+extern volatile bool gateActive;
+
+void Gate_ClearStats(void);
+void Gate_Start(uint16_t minimumOffset, uint16_t maximumOffset, uint16_t sweepSteps, uint16_t holdoff, gateOrder_e order, uint32_t startIndex);
+void Gate_SetIndex(uint32_t index);
+uint32_t Gate_GetIndex(void);
+void Gate_Service(void);
+void Gate_Stop(void);
+uint32_t Gate_GetHits(void);
+uint16_t Gate_GetOffset(void);
+void Gate_PrintStats(void);
+void Gate_BusyEdgeIsr(void);
+bool Gate_CompareIsr(void);
+functionResult_e Gate_Setup(unsigned int numArgs, int args[]);
+
+#endif // GATE_H
\ No newline at end of file
@@ -0,0 +1,323 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <conio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+#include "utils.h"
+#include "powerlossemu.h"
+#include "pulsecounter.h"
+#include "glitch.h"
+
+// Helpers for writing patterns in microseconds
+#define US(x)           ((uint8_t)(((x) * 3) / 2))
+#define PATTERN_1(a)                    1, US(a)
+#define PATTERN_3(a, b, c)              3, US(a), US(b), US(c)
+#define PATTERN_7(a, b, c, d, e, f, g)  7, US(a), US(b), US(c), US(d), US(e), US(f), US(g)
+
+typedef struct glitchPattern
+{
+    const char          *name;
+    const uint8_t       *phases;
+} glitchPattern_t;
+
+// Low, high, low... in us
+static const uint8_t dropoutPattern[] = {PATTERN_1(8)};
+static const uint8_t bouncePattern[] = {PATTERN_3(20, 8, 40)};
+static const uint8_t doubleDipPattern[] = {PATTERN_3(100, 20, 100)};
+static const uint8_t chatterPattern[] = {PATTERN_7(10, 8, 10, 8, 10, 8, 80)};
+
+static const glitchPattern_t builtInPatterns[] =
+{
+    {"Single pulse", 0},
+    {"Dropout",      dropoutPattern},
+    {"Bounce",       bouncePattern},
+    {"Double dip",   doubleDipPattern},
+    {"Chatter",      chatterPattern},
+};
+#define NUM_BUILT_IN_PATTERNS (sizeof(builtInPatterns)/sizeof(glitchPattern_t))
+
+static uint8_t enteredPattern[1 + GLITCH_MAX_PHASES];
+static const uint8_t *selectedPattern;
+static const char *patternName;
+
+volatile bool glitchActive;
+volatile bool glitchPlaying;
+
+// Copied out of flash at the start of a run so the interrupt reads RAM
+static uint8_t numPhases;
+static uint8_t phaseTicks[GLITCH_MAX_PHASES];
+static uint16_t patternTicks;
+
+// Interrupt state
+static uint8_t phase;
+static uint16_t resumeTicks;
+static bool compareWasOff;
+static volatile uint16_t lateEdges;
+static volatile uint16_t stretchedPeriods;
+
+static bool Glitch_Enter(void)
+{
+    uint8_t count = 0;
+    uint16_t value = 0;
+    bool inNumber = false;
+    char c;
+
+    Console_PrintNoEol("Enter phases in ticks, low first (max %d): ", GLITCH_MAX_PHASES);
+    // Parse straight off the wire like sequence uploads, phases past the end
+    // are counted but not kept
+    do
+    {
+        c = getche();
+        if ((c >= '0') && (c <= '9'))
+        {
+            // Stop growing once it's out of range, the check below catches it
+            if (value <= UINT8_MAX)
+            {
+                value = (value * 10) + (c - '0');
+            }
+            inNumber = true;
+        }
+        else if (inNumber)
+        {
+            if ((value < GLITCH_MIN_TICKS) || (value > UINT8_MAX))
+            {
+                Console_PrintNewLine();
+                Console_Print(ANSI_COLOR_RED" Phases have to be %d to %d ticks!"ANSI_COLOR_RESET, GLITCH_MIN_TICKS, UINT8_MAX);
+                return false;
+            }
+            if (count < GLITCH_MAX_PHASES)
+            {
+                enteredPattern[1 + count] = (uint8_t)value;
+            }
+            count++;
+            value = 0;
+            inNumber = false;
+        }
+    }
+    while (c != '\r');
+    Console_PrintNewLine();
+
+    if (count > GLITCH_MAX_PHASES)
+    {
+        Console_Print(ANSI_COLOR_RED" Too many phases!"ANSI_COLOR_RESET);
+        return false;
+    }
+    // An even count would leave the last phase high, which is just the
+    // supply being back
+    if ((count & 1) == 0)
+    {
+        Console_Print(ANSI_COLOR_RED" Needs an odd number of phases so it ends low!"ANSI_COLOR_RESET);
+        return false;
+    }
+    enteredPattern[0] = count;
+
+    return true;
+}
+
+// Next match after ticks, or as soon as possible if TMR3 is already past it
+// rather than waiting for it to come all the way around
+static void Glitch_LoadTicks(uint16_t ticks)
+{
+    CCPR1 = ticks;
+    if (TMR3 >= ticks)
+    {
+        CCPR1 = TMR3 + 2;
+        lateEdges++;
+    }
+}
+
+void Glitch_Init(void)
+{
+    selectedPattern = builtInPatterns[0].phases;
+    patternName = builtInPatterns[0].name;
+}
+
+bool Glitch_IsEnabled(void)
+{
+    return (selectedPattern != 0);
+}
+
+// The pulse counter on RB3 sees one rising edge per low phase
+uint8_t Glitch_GetLowsPerPulse(void)
+{
+    if (selectedPattern == 0)
+    {
+        return 1;
+    }
+
+    return (selectedPattern[0] + 1) / 2;
+}
+
+void Glitch_Start(void)
+{
+    if (selectedPattern == 0)
+    {
+        return;
+    }
+
+    numPhases = selectedPattern[0];
+    patternTicks = 0;
+    for (uint8_t i = 0; i < numPhases; i++)
+    {
+        phaseTicks[i] = selectedPattern[1 + i];
+        patternTicks += phaseTicks[i];
+    }
+    lateEdges = 0;
+    stretchedPeriods = 0;
+    glitchPlaying = false;
+    glitchActive = true;
+}
+
+// Only once the comparator is off
+void Glitch_Stop(void)
+{
+    glitchActive = false;
+    // A pattern cut short leaves RB0 wherever it was
+    glitchPlaying = false;
+    LATBbits.LATB0 = 1;
+}
+
+void Glitch_PrintStats(void)
+{
+    if (selectedPattern == 0)
+    {
+        return;
+    }
+
+    Console_Print("Glitch pattern:  %s, %u phases over %u us", patternName, selectedPattern[0], (uint16_t)(((uint32_t)patternTicks * 2) / 3));
+    if (lateEdges != 0)
+    {
+        Console_Print(ANSI_COLOR_RED" %u edges came late, phases too short for the interrupt"ANSI_COLOR_RESET, lateEdges);
+    }
+    if (stretchedPeriods != 0)
+    {
+        Console_Print(ANSI_COLOR_RED" %u periods were stretched, the pattern is longer than the period"ANSI_COLOR_RESET, stretchedPeriods);
+    }
+}
+
+// Called at the end of the ECCP1 branch of an event that pulsed, with RB0
+// already low. Everything above has set CCPR1 up for the period that just
+// started, the pattern borrows the comparator and hands it back after.
+void Glitch_BeginIsr(void)
+{
+    resumeTicks = CCPR1;
+    // Gated windows turn it off after their one match
+    compareWasOff = (CCP1CONbits.CCP1M != 0xB);
+    phase = 0;
+    Glitch_LoadTicks(phaseTicks[0]);
+    if (compareWasOff)
+    {
+        CCP1CONbits.CCP1M = 0xB;    // 0b1011 = Compare mode, trigger special event
+    }
+}
+
+// Every match while a pattern is playing
+void Glitch_CompareIsr(void)
+{
+    phase++;
+    if (phase < numPhases)
+    {
+        // Even phases are low, odd ones high
+        LATBbits.LATB0 = phase & 1;
+        Glitch_LoadTicks(phaseTicks[phase]);
+        return;
+    }
+
+    LATBbits.LATB0 = 1;
+    glitchPlaying = false;
+    if (compareWasOff)
+    {
+        CCP1CONbits.CCP1M = 0x0;    // 0b0000 = Capture/Compare/PWM off (resets ECCPx module)
+    }
+    else if (resumeTicks >= (patternTicks + GLITCH_MIN_TICKS))
+    {
+        Glitch_LoadTicks(resumeTicks - patternTicks);
+    }
+    else
+    {
+        Glitch_LoadTicks(GLITCH_MIN_TICKS);
+        stretchedPeriods++;
+    }
+    // The pulse target may have been reached partway through
+    PulseCounter_PatternDoneIsr();
+}
+
+functionResult_e Glitch_Setup(unsigned int numArgs, int args[])
+{
+    unsigned int selection;
+
+    // The interrupt reads the pattern while a run is going
+    if (PowerLossEmu_IsRunning())
+    {
+        Console_Print(ANSI_COLOR_RED" Stop the running workload first!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+
+    Console_Print("Current pattern: %s", patternName);
+    Console_PrintDivider();
+    for (uint8_t i = 0; i < NUM_BUILT_IN_PATTERNS; i++)
+    {
+        Console_Print("[%d]-%s", i, builtInPatterns[i].name);
+    }
+    Console_Print("[%d]-Enter phases", NUM_BUILT_IN_PATTERNS);
+    Console_PrintDivider();
+    // Arguments: pattern
+    selection = Console_ArgOrPromptForInt(numArgs, args, 0, "Enter pattern: ");
+
+    if (selection < NUM_BUILT_IN_PATTERNS)
+    {
+        selectedPattern = builtInPatterns[selection].phases;
+        patternName = builtInPatterns[selection].name;
+    }
+    else if (selection == NUM_BUILT_IN_PATTERNS)
+    {
+        if (!Glitch_Enter())
+        {
+            // The buffer may be half written, don't leave it selected
+            if (selectedPattern == enteredPattern)
+            {
+                Glitch_Init();
+            }
+            return ERROR;
+        }
+        selectedPattern = enteredPattern;
+        patternName = "Entered";
+    }
+    else
+    {
+        Console_Print(ANSI_COLOR_RED" Bad selection!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+    Console_Print("Selected pattern: %s", patternName);
+    if (selectedPattern != 0)
+    {
+        Console_Print("Synced runs keep the single pulse, loopback timing is left out of the rest");
+    }
+
+    return SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef GLITCH_H
+#define GLITCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+
+// A glitch pattern replaces the single pulse on RB0 with a train of edges,
+// like a supply that bounces before it settles. Patterns are a byte count
+// followed by that many phase lengths in Timer3 ticks (0.67 us), starting
+// with RB0 low and alternating, so an odd count ends low and RB0 goes back
+// high after the last phase.
+//
+// Every phase is a compare match of its own. The special event resets TMR3
+// on each one, so phase lengths are exact and the interrupt only has to
+// move RB0 and load the next length before TMR3 gets there. What's left of
+// the period is loaded after the last phase so the events stay on time.
+// Edges land at the interrupt latency after each match, so they carry its
+// jitter but never build up an error.
+#define GLITCH_MAX_PHASES       (9)
+// The interrupt has to get in and reload CCPR1 before TMR3 reaches it.
+// Shorter phases still come out, just late, and are counted.
+#define GLITCH_MIN_TICKS        (12)    // 8 us
+
+extern volatile bool glitchActive;
+extern volatile bool glitchPlaying;
+
+void Glitch_Init(void);
+bool Glitch_IsEnabled(void);
+uint8_t Glitch_GetLowsPerPulse(void);
+void Glitch_Start(void);
+void Glitch_Stop(void);
+void Glitch_PrintStats(void);
+void Glitch_BeginIsr(void);
+void Glitch_CompareIsr(void);
+functionResult_e Glitch_Setup(unsigned int numArgs, int args[]);
+
+#endif // GLITCH_H
\ No newline at end of file
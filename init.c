@@ -49,6 +49,41 @@ void Init_Gpio(void)
     // Setup RC7 and RC6 for UART RX/TX
     TRISCbits.TRISC7 = 1; // RX - input
     TRISCbits.TRISC6 = 0; // TX - output
+    // Set RB3 as a digital input for the pulse counter (jumpered to RB0)
+    ANCON1bits.PCFG9 = 1;   // 0b1 = AN9 (RB3) is digital
+    TRISBbits.TRISB3 = 1;
+    // RB1 is the multi-board sync line, an input until this board leads
+    ANCON1bits.PCFG10 = 1;  // 0b1 = AN10 (RB1) is digital
+    LATBbits.LATB1 = 1;     // Idles high, edges are falling
+    TRISBbits.TRISB1 = 1;
+    INTCON2bits.INTEDG1 = 0;// 0b0 = INT1 interrupts on falling edge
+    // RD2 watches the DUT busy line for gated workloads
+    TRISDbits.TRISD2 = 1;
+    // RC0 carries the brownout PWM
+    TRISCbits.TRISC0 = 0;
+    // Setup RB4 and RB5 for the sync UART TX/RX
+    TRISBbits.TRISB5 = 1;   // RX2 - input
+    TRISBbits.TRISB4 = 0;   // TX2 - output
+}
+
+void Init_Pps(void)
+{
+    // Peripheral pin select can only be unlocked once (IOL1WAY = ON), so
+    // every remappable pin has to be assigned here
+    INTCONbits.GIE = 0;
+    EECON2 = 0x55;
+    EECON2 = 0xAA;
+    PPSCONbits.IOLOCK = 0;
+    RPINR4 = 6;             // T0CKI <- RP6 (RB3), pulse counter input
+    RPINR1 = 4;             // INT1 <- RP4 (RB1), sync line
+    RPINR8 = 6;             // IC2 <- RP6 (RB3), loopback capture
+    RPINR2 = 19;            // INT2 <- RP19 (RD2), DUT busy line
+    RPINR16 = 8;            // RX2 <- RP8 (RB5), sync UART
+    RPOR7 = 5;              // RP7 (RB4) <- TX2, sync UART
+    RPOR11 = 18;            // RP11 (RC0) <- P2A, brownout PWM
+    EECON2 = 0x55;
+    EECON2 = 0xAA;
+    PPSCONbits.IOLOCK = 1;
 }
 
 void Init_Timer0(void)
@@ -61,6 +96,16 @@ void Init_Timer0(void)
     T0CONbits.TMR0ON = 1;   // Enable timer
 }
 
+void Init_Timer0Counter(void)
+{
+    // Count falling edges (power-loss pulses are active low) on T0CKI
+    T0CONbits.T0CS = 1;     // Transition on T0CKI pin
+    T0CONbits.T0SE = 1;     // Increment on high-to-low transition
+    T0CONbits.PSA = 1;      // No prescaler, count every edge
+    T0CONbits.T08BIT = 0;   // 16-bit counter mode
+    T0CONbits.TMR0ON = 0;   // Started when a pulse target is armed
+}
+
 void Init_Timer1(void)
 {
     // (48 MHz)/(4 FOSC) = 12 MHz tick rate
@@ -91,6 +136,15 @@ void Init_Timer3(void)
     T3CONbits.TMR3ON = 1;   // 0b1 = Timer3 is on
 }
 
+void Init_Timer4(void)
+{
+    // (48 MHz)/(4 FOSC)/(256 PR4) = 46.875 kHz PWM period, 10-bit duty
+    T4CONbits.T4OUTPS = 0x0;// 0b0000 = 1:1 Postscale
+    T4CONbits.T4CKPS = 0x0; // 0b00 = Prescaler is 1
+    PR4 = 255;
+    T4CONbits.TMR4ON = 1;   // 0b1 = Timer4 is on
+}
+
 void Init_Eccp1(void)
 {
     // (48 MHz)/(4 FOSC) = 12 MHz tick rate
@@ -99,6 +153,29 @@ void Init_Eccp1(void)
     PIE1bits.CCP1IE = 1;    // Enable ECCP1 interrupt
 }
 
+void Init_Eccp2Pwm(void)
+{
+    // Timer4 is the PWM time base, see TCLKCON in Init_Eccp1
+    CCP2CONbits.P2M = 0x0;  // 0b00 = Single output, P2A modulated
+    CCPR2L = 0xFF;          // Full duty until a brownout says otherwise
+    CCP2CONbits.DC2B = 0x3;
+    CCP2CONbits.CCP2M = 0xC;// 0b1100 = PWM mode, P2A active-high
+}
+
+void Init_Adc(void)
+{
+    // AN0 (RA0) watches the DUT rail for captures
+    ANCON0bits.PCFG0 = 0;   // 0b0 = AN0 is analog
+    TRISAbits.TRISA0 = 1;
+    ADCON0bits.VCFG1 = 0;   // 0b0 = Negative reference is AVss
+    ADCON0bits.VCFG0 = 0;   // 0b0 = Positive reference is AVdd
+    ADCON0bits.CHS = 0x0;   // 0b0000 = AN0
+    ADCON1bits.ADFM = 1;    // 0b1 = Right justified
+    ADCON1bits.ACQT = 0x1;  // 0b001 = 2 TAD acquisition
+    ADCON1bits.ADCS = 0x6;  // 0b110 = FOSC/64, 1.33 us TAD
+    ADCON0bits.ADON = 1;    // 0b1 = A/D is on, ECCP1 special events start conversions
+}
+
 void Init_Eusart1(void)
 {
     RCSTA1bits.SPEN = 1;    // Serial port enable
@@ -122,8 +199,34 @@ void Init_Eusart1(void)
     SPBRG1  = 0x67;
 }
 
+void Init_Eusart2(void)
+{
+    // Same framing and baud rate as EUSART1, see above
+    RCSTA2bits.SPEN = 1;    // Serial port enable
+    TXSTA2bits.SYNC = 0;    // Asynchronous operation
+    RCSTA2bits.CREN = 1;    // Enable receive
+    TXSTA2bits.TXEN = 1;    // Enable transmit
+    TXSTA2bits.BRGH = 1;    // High baud rate select bit
+    BAUDCON2bits.BRG16 = 1; // 16 bit baud rate generator
+    SPBRGH2 = 0x00;
+    SPBRG2  = 0x67;
+}
+
 void Init_Interrupts(void)
 {
-    INTCONbits.GIE = 1;     // 0b1 = Enables all unmasked interrupts
-    INTCONbits.PEIE = 1;    // 0b1 = Enables all unmasked peripheral interrupts (when GIE is also set)
+    // See interrupts.c for what goes on which vector
+    RCONbits.IPEN = 1;      // 0b1 = Enable priority levels on interrupts
+    IPR1bits.CCP1IP = 1;    // 0b1 = High priority, power-loss pulse
+    INTCON3bits.INT1IP = 1; // 0b1 = High priority, sync edge
+    INTCON3bits.INT2IP = 1; // 0b1 = High priority, DUT busy edge
+    INTCON2bits.TMR0IP = 1; // 0b1 = High priority, pulse counter
+    IPR1bits.TMR2IP = 0;    // 0b0 = Low priority, uptime tick
+    IPR1bits.ADIP = 0;      // 0b0 = Low priority, capture samples
+    IPR2bits.CCP2IP = 0;    // 0b0 = Low priority, loopback capture
+    IPR1bits.RC1IP = 0;     // 0b0 = Low priority, console UART
+    IPR1bits.TX1IP = 0;
+    IPR3bits.RC2IP = 0;     // 0b0 = Low priority, sync UART
+    IPR3bits.TX2IP = 0;
+    INTCONbits.GIEH = 1;    // 0b1 = Enables all high priority interrupts
+    INTCONbits.GIEL = 1;    // 0b1 = Enables all low priority interrupts (when GIEH is also set)
 }
\ No newline at end of file
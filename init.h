@@ -27,12 +27,18 @@
 
 void Init_System(void);
 void Init_Gpio(void);
+void Init_Pps(void);
 void Init_Timer0(void);
+void Init_Timer0Counter(void);
 void Init_Timer1(void);
 void Init_Timer2(void);
 void Init_Timer3(void);
+void Init_Timer4(void);
 void Init_Eccp1(void);
+void Init_Eccp2Pwm(void);
+void Init_Adc(void);
 void Init_Eusart1(void);
+void Init_Eusart2(void);
 void Init_Interrupts(void);
 
 #endif // INIT_H
\ No newline at end of file
@@ -25,22 +25,174 @@
 #include <xc.h>
 
 #include "utils.h"
+#include "profile.h"
+#include "dds.h"
+#include "pulsecounter.h"
+#include "sync.h"
+#include "burst.h"
+#include "brownout.h"
+#include "capture.h"
+#include "loopback.h"
+#include "gate.h"
+#include "bench.h"
+#include "coverage.h"
+#include "calibration.h"
+#include "glitch.h"
 
-void __interrupt () interruptHandler(void)
+// Interrupt priorities are enabled in Init_Interrupts. Everything that
+// decides when a pulse or sync edge happens is high priority, so the tick
+// can never hold up a compare match:
+//
+//   High: ECCP1 compare, INT1 sync edge, INT2 DUT busy edge, Timer0 pulse
+//         counter overflow
+//   Low:  Timer2 tick, A/D capture samples, ECCP2 loopback capture (and
+//         the UARTs if they ever get interrupts)
+//
+// The high priority vector returns with RETFIE FAST, so WREG, STATUS and
+// BSR come back out of the shadow registers instead of being saved and
+// restored by code. The rest of the context is still saved by the compiler,
+// and the path isn't light: pulseCount, the coverage index and the
+// calibration cycle sum are 32-bit updates, and matches call down through
+// the burst, gate, glitch, sync and coverage handlers. Anything added here
+// lands on top of that in the latency.
+//
+// Pulse latency is sampled on every match as TMR3 on entry to the ECCP1
+// branch. TMR3 was cleared by the special event, so it's the time since the
+// match in 0.67 us ticks. The worst case seen is shown by the Latency
+// command. With priorities it's bounded by the vector latency, the context
+// save and at most one INT1 or Timer0 branch ahead of it. It no longer
+// includes a Timer2 tick or A/D sample that happened to be running.
+
+void __interrupt(high_priority) highPriorityHandler(void)
 {
+    uint16_t latency;
+
+    PROFILE_START(PROFILE_REGION_ISR);
+
+    // INT1 Interrupt, first so the sync edge is timestamped with as little
+    // and as steady a delay as possible
+    if (INTCON3bits.INT1IE && INTCON3bits.INT1IF)
+    {
+        INTCON3bits.INT1IF = 0;
+        Sync_EdgeIsr();
+    }
+
+    // INT2 Interrupt, only enabled while a gated workload waits for the DUT
+    // to go busy. Ahead of ECCP1 since the offset counts from here.
+    if (INTCON3bits.INT2IE && INTCON3bits.INT2IF)
+    {
+        INTCON3bits.INT2IF = 0;
+        Gate_BusyEdgeIsr();
+    }
+
     // ECCP1 Interrupt
-    if (PIR1bits.CCP1IF)
+    if (PIE1bits.CCP1IE && PIR1bits.CCP1IF)
     {
+        latency = TMR3;
         PIR1bits.CCP1IF = 0;
-        // Generate power-loss pulse
-        Util_GeneratePulseRB0();
+        // Matches inside a glitch pattern only move RB0 on to its next edge
+        if (glitchPlaying)
+        {
+            Glitch_CompareIsr();
+        }
+        else
+        {
+            if (syncActive)
+            {
+                Sync_CompareIsr();
+            }
+            // Generate power-loss pulse, bursts skip it on matches that only
+            // split up a long gap and gated windows if the DUT is done
+            // already. Calibration only wants the match times.
+            if (!calibrationActive && (!burstActive || Burst_CompareIsr()) && (!gateActive || Gate_CompareIsr()))
+            {
+                if (glitchActive)
+                {
+                    // First edge now, the pattern takes over the comparator
+                    // below once the next period is known
+                    LATBbits.LATB0 = 0;
+                    glitchPlaying = true;
+                }
+                else
+                {
+                    Util_GeneratePulseRB0();
+                }
+                pulseCount++;
+            }
+            Util_ApplyStagedCompareValue();
+            if (ddsActive)
+            {
+                Dds_CompareIsr();
+            }
+            else if (coverageActive)
+            {
+                Coverage_CompareIsr();
+            }
+            if (latency > pulseLatencyWorst)
+            {
+                pulseLatencyWorst = latency;
+            }
+            if (benchActive)
+            {
+                Bench_CompareIsr();
+            }
+            if (calibrationActive)
+            {
+                Calibration_CompareIsr();
+            }
+            if (glitchPlaying)
+            {
+                Glitch_BeginIsr();
+            }
+        }
+    }
+
+    // Timer0 Overflow Interrupt, checked after ECCP1 so the last pulse of a
+    // target stops the comparator before it can match again
+    if (INTCONbits.TMR0IE && INTCONbits.TMR0IF)
+    {
+        INTCONbits.TMR0IF = 0;
+        PulseCounter_OverflowIsr();
     }
-    
+
+    PROFILE_STOP(PROFILE_REGION_ISR);
+}
+
+void __interrupt(low_priority) lowPriorityHandler(void)
+{
+    PROFILE_START(PROFILE_REGION_LOW_ISR);
+
+    // A/D Interrupt, only enabled while capturing
+    if (PIE1bits.ADIE && PIR1bits.ADIF)
+    {
+        PIR1bits.ADIF = 0;
+        Capture_AdcIsr();
+    }
+
+    // ECCP2 Interrupt, only enabled while the loopback is measuring. The
+    // edge time is latched by the hardware so it can wait its turn here.
+    if (PIE2bits.CCP2IE && PIR2bits.CCP2IF)
+    {
+        PIR2bits.CCP2IF = 0;
+        Loopback_CaptureIsr();
+    }
+
     // Timer2 Match Interrupt
     if (PIR1bits.TMR2IF)
     {
         PIR1bits.TMR2IF = 0;
         // 10 us tick
-        uptimeTicksMicroSeconds += 10;
+        Util_UptimeTickIsr();
+        // Only worth the 32-bit add while a DDS workload reads it
+        if (ddsActive)
+        {
+            ddsPhase += ddsPhaseIncrement;
+        }
+        if (brownoutActive)
+        {
+            Brownout_TickIsr();
+        }
     }
+
+    PROFILE_STOP(PROFILE_REGION_LOW_ISR);
 }
\ No newline at end of file
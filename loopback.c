@@ -0,0 +1,312 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "console.h"
+#include "init.h"
+#include "utils.h"
+#include "powerlossemu.h"
+#include "brownout.h"
+#include "loopback.h"
+
+#define LOOPBACK_RING_MASK  (LOOPBACK_RING_SIZE - 1)
+
+#if ((LOOPBACK_RING_SIZE & LOOPBACK_RING_MASK) != 0) || (LOOPBACK_RING_SIZE > 256)
+#error "LOOPBACK_RING_SIZE has to be a power of two, no more than 256"
+#endif
+
+static bool loopbackEnabled;
+volatile bool loopbackActive;
+
+// Filled by the capture interrupt, drained by Loopback_Service
+static volatile uint16_t ring[LOOPBACK_RING_SIZE];
+static volatile uint8_t ringHead;
+static volatile uint8_t ringTail;
+static volatile uint32_t edges;
+static volatile uint16_t overruns;
+static uint16_t lastOverruns;
+
+// Statistics, all in Timer3 ticks
+static uint32_t startPulses;
+static uint32_t pulses;
+static uint32_t measured;
+// Sums are exact integers so week long runs don't stop adding up. Latency is
+// summed relative to the first one, which keeps the squares down to the
+// size of the jitter and the variance from cancelling out.
+static uint16_t latencyOrigin;
+static int64_t latencyDeltaSum;
+static uint64_t latencyDeltaSquares;
+static uint16_t latencyMin;
+static uint16_t latencyMax;
+static uint32_t periodsCompared;
+static uint64_t errorSquares;
+static int16_t errorMin;
+static int16_t errorMax;
+static uint16_t previousLatency;
+static bool havePrevious;
+
+static int32_t Loopback_TicksToNanoseconds(int32_t ticks)
+{
+    // 2 us for every 3 ticks
+    return (ticks * 2000) / 3;
+}
+
+bool Loopback_IsEnabled(void)
+{
+    return loopbackEnabled;
+}
+
+void Loopback_Start(void)
+{
+    ringHead = 0;
+    ringTail = 0;
+    edges = 0;
+    overruns = 0;
+    lastOverruns = 0;
+    startPulses = Util_GetPulseCount();
+    pulses = 0;
+    measured = 0;
+    latencyDeltaSum = 0;
+    latencyDeltaSquares = 0;
+    latencyMin = UINT16_MAX;
+    latencyMax = 0;
+    periodsCompared = 0;
+    errorSquares = 0;
+    errorMin = INT16_MAX;
+    errorMax = INT16_MIN;
+    havePrevious = false;
+
+    // P2A idles low outside PWM mode, let go of the brownout driver instead
+    // of pulling the supply down
+    TRISCbits.TRISC0 = 1;
+    CCP2CONbits.CCP2M = 0x0;    // 0b0000 = Capture/Compare/PWM off (resets ECCPx module)
+    CCP2CONbits.CCP2M = 0x4;    // 0b0100 = Capture mode, every falling edge
+    PIR2bits.CCP2IF = 0;
+    loopbackActive = true;
+    PIE2bits.CCP2IE = 1;        // Enable ECCP2 interrupt
+}
+
+void Loopback_Service(void)
+{
+    uint16_t latency;
+    int16_t error;
+    int32_t delta;
+
+    // Edges dropped in between break the chain from one to the next
+    if (overruns != lastOverruns)
+    {
+        lastOverruns = overruns;
+        havePrevious = false;
+    }
+
+    while (ringTail != ringHead)
+    {
+        latency = ring[ringTail];
+        ringTail = (ringTail + 1) & LOOPBACK_RING_MASK;
+
+        if (measured == 0)
+        {
+            latencyOrigin = latency;
+        }
+        measured++;
+        delta = (int32_t)latency - latencyOrigin;
+        latencyDeltaSum += delta;
+        latencyDeltaSquares += (uint32_t)delta * (uint32_t)delta;
+        if (latency < latencyMin)
+        {
+            latencyMin = latency;
+        }
+        if (latency > latencyMax)
+        {
+            latencyMax = latency;
+        }
+
+        // Matches land exactly where they were scheduled, so a period came
+        // out as much longer than commanded as its pulse was later after
+        // the match than the one before
+        if (havePrevious)
+        {
+            error = (int16_t)(latency - previousLatency);
+            periodsCompared++;
+            errorSquares += (uint32_t)((int32_t)error * error);
+            if (error < errorMin)
+            {
+                errorMin = error;
+            }
+            if (error > errorMax)
+            {
+                errorMax = error;
+            }
+        }
+        previousLatency = latency;
+        havePrevious = true;
+    }
+}
+
+void Loopback_Stop(void)
+{
+    PIE2bits.CCP2IE = 0;
+    loopbackActive = false;
+    Loopback_Service();
+    pulses = Util_GetPulseCount() - startPulses;
+
+    // Back to the brownout PWM, at full supply
+    Init_Eccp2Pwm();
+    TRISCbits.TRISC0 = 0;
+}
+
+void Loopback_PrintStats(void)
+{
+    float meanDelta;
+    float variance;
+
+    Console_Print("Pulses:          %10lu", pulses);
+    Console_Print("Edges captured:  %10lu", edges);
+    if (edges == 0)
+    {
+        Console_Print(ANSI_COLOR_RED" No edges captured, is RB0 jumpered to RB3?"ANSI_COLOR_RESET);
+        return;
+    }
+    if (edges < pulses)
+    {
+        Console_Print(ANSI_COLOR_RED" %lu pulses never showed up on RB3!"ANSI_COLOR_RESET, pulses - edges);
+    }
+    if (measured < edges)
+    {
+        Console_Print("Not measured:    %10lu (main loop fell behind)", edges - measured);
+    }
+    if (measured == 0)
+    {
+        return;
+    }
+
+    meanDelta = (float)latencyDeltaSum / measured;
+    variance = ((float)latencyDeltaSquares / measured) - (meanDelta * meanDelta);
+    Console_Print("Latency min:     %10ld ns", Loopback_TicksToNanoseconds(latencyMin));
+    Console_Print("Latency mean:    %10ld ns", (int32_t)((((latencyOrigin + meanDelta) * 2000.0) / 3.0) + 0.5));
+    Console_Print("Latency max:     %10ld ns", Loopback_TicksToNanoseconds(latencyMax));
+    Console_Print("Jitter (rms):    %10ld ns", (int32_t)((sqrtf((variance > 0.0) ? variance : 0.0) * 2000.0) / 3.0));
+    if (periodsCompared != 0)
+    {
+        Console_Print("Period error:    %10ld to %ld ns", Loopback_TicksToNanoseconds(errorMin), Loopback_TicksToNanoseconds(errorMax));
+        Console_Print("Period error rms:%10ld ns", (int32_t)((sqrtf((float)errorSquares / periodsCompared) * 2000.0) / 3.0));
+    }
+}
+
+// Called from the ECCP2 interrupt on every falling edge on RB3
+void Loopback_CaptureIsr(void)
+{
+    uint8_t next = (ringHead + 1) & LOOPBACK_RING_MASK;
+
+    edges++;
+    if (next == ringTail)
+    {
+        overruns++;
+        return;
+    }
+    ring[ringHead] = CCPR2;
+    ringHead = next;
+}
+
+functionResult_e Loopback_Setup(unsigned int numArgs, int args[])
+{
+    Console_Print("Loopback measurement is currently %s", loopbackEnabled ? "on" : "off");
+    Console_Print("Every pulse is timed by ECCP2 on RB3, jumper RB0 to RB3");
+    // Arguments: enable
+    loopbackEnabled = (Console_ArgOrPromptForInt(numArgs, args, 0, "Enable loopback during runs (0/1): ") != 0);
+    if (loopbackEnabled && Brownout_IsLinkedToWorkloads())
+    {
+        Console_Print("Brownouts are left out of runs while it's on, both need ECCP2");
+    }
+
+    return SUCCESS;
+}
+
+// Runs a short fixed workload through the loopback and checks the pulses
+// came out on time. Also run at boot.
+functionResult_e Loopback_SelfTest(unsigned int numArgs, int args[])
+{
+    uint32_t startTime;
+    bool passed = true;
+
+    // The test workload would fight the run over the comparator
+    if (PowerLossEmu_IsRunning())
+    {
+        Console_Print(ANSI_COLOR_RED" Stop the running workload first!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+
+    Console_Print("Self-test: %d pulses at %d us on RB0, measured on RB3", LOOPBACK_TEST_PULSES, LOOPBACK_TEST_PERIOD_US);
+    pulseCount = 0;
+    Loopback_Start();
+    Util_SetNewCompareValue(LOOPBACK_TEST_PERIOD_US);
+    startTime = Util_GetMicrosecondUptime();
+    // Give up after twice as long as it should take
+    while ((Util_GetPulseCount() < LOOPBACK_TEST_PULSES) &&
+           ((Util_GetMicrosecondUptime() - startTime) < (2UL * LOOPBACK_TEST_PULSES * LOOPBACK_TEST_PERIOD_US)))
+    {
+        Loopback_Service();
+    }
+    Util_SetNewCompareValue(0);
+    Loopback_Stop();
+    Loopback_PrintStats();
+
+    if (pulses < LOOPBACK_TEST_PULSES)
+    {
+        Console_Print(ANSI_COLOR_RED" Only %lu of %d pulses were generated!"ANSI_COLOR_RESET, pulses, LOOPBACK_TEST_PULSES);
+        passed = false;
+    }
+    else if (edges == 0)
+    {
+        Console_Print("Self-test skipped");
+        return SUCCESS;
+    }
+    else if (edges != pulses)
+    {
+        passed = false;
+    }
+    if ((measured != 0) && (latencyMax > ((LOOPBACK_TEST_MAX_LATENCY_US * 3) / 2)))
+    {
+        Console_Print(ANSI_COLOR_RED" Pulses come out more than %d us after the match!"ANSI_COLOR_RESET, LOOPBACK_TEST_MAX_LATENCY_US);
+        passed = false;
+    }
+    if ((periodsCompared != 0) && ((errorMax > ((LOOPBACK_TEST_MAX_ERROR_US * 3) / 2)) || (-errorMin > ((LOOPBACK_TEST_MAX_ERROR_US * 3) / 2))))
+    {
+        Console_Print(ANSI_COLOR_RED" Periods are more than %d us off!"ANSI_COLOR_RESET, LOOPBACK_TEST_MAX_ERROR_US);
+        passed = false;
+    }
+
+    if (passed)
+    {
+        Console_Print(ANSI_COLOR_GREEN" Self-test passed"ANSI_COLOR_RESET);
+        return SUCCESS;
+    }
+    Console_Print(ANSI_COLOR_RED" Self-test failed"ANSI_COLOR_RESET);
+
+    return ERROR;
+}
\ No newline at end of file
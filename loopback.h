@@ -0,0 +1,59 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef LOOPBACK_H
+#define LOOPBACK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+
+// Measures every pulse with ECCP2 in capture mode on RB3 (IC2, RP6), the
+// same RB0 jumper the pulse counter uses. Timer3 is reset by each compare
+// match, so the captured value is how long the pulse took to come out after
+// the match that scheduled it. ECCP2 can't run the brownout PWM meanwhile.
+// Holds pulses the main loop hasn't got to yet, builds can change it with
+// -DLOOPBACK_RING_SIZE
+#ifndef LOOPBACK_RING_SIZE
+#define LOOPBACK_RING_SIZE              (64)    // Power of two, up to 256
+#endif
+// Boot self-test
+#define LOOPBACK_TEST_PULSES            (200)
+#define LOOPBACK_TEST_PERIOD_US         (1000)
+#define LOOPBACK_TEST_MAX_LATENCY_US    (20)
+#define LOOPBACK_TEST_MAX_ERROR_US      (5)
+
+extern volatile bool loopbackActive;
+
+bool Loopback_IsEnabled(void);
+void Loopback_Start(void);
+void Loopback_Service(void);
+void Loopback_Stop(void);
+void Loopback_PrintStats(void);
+void Loopback_CaptureIsr(void);
+functionResult_e Loopback_Setup(unsigned int numArgs, int args[]);
+functionResult_e Loopback_SelfTest(unsigned int numArgs, int args[]);
+
+#endif // LOOPBACK_H
\ No newline at end of file
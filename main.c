@@ -34,25 +34,39 @@
 #include "console.h"
 #include "menus.h"
 #include "powerlossemu.h"
+#include "profile.h"
+#include "brownout.h"
+#include "playlist.h"
+#include "checkpoint.h"
+#include "loopback.h"
+#include "calibration.h"
 
 void main(void)
 {   
     Init_System();
     Init_Gpio();
+    Init_Pps();
+    Init_Timer0Counter();
     Init_Timer2();
     Init_Timer3();
+    Init_Timer4();
     Init_Eccp1();
+    Init_Eccp2Pwm();
+    Init_Adc();
     Init_Eusart1();
+    Init_Eusart2();
     Init_Interrupts();
+    Profile_Init();
 
     // Wait a bit for things to stabilize
     Util_WaitMicrosecond(50);
     
     // Initialize program variables
     PowerLossEmu_Init();
+    Brownout_Init();
 
-    // Setup console interface
-    consoleSettings_t consoleSettings = 
+    // Setup console interface, const keeps it in program memory
+    static const consoleSettings_t consoleSettings = 
     {
         &splashScreen,
         NUM_SPLASH_LINES,
@@ -61,12 +75,25 @@ void main(void)
     Console_Init(&consoleSettings);
     // Erase screen
     Console_Print(ERASE_SCREEN);
+    // Periods are corrected from here on, only measured on the first boot
+    Calibration_Init();
+    // Soaks carry on from their last checkpoint after a brown-out or
+    // watchdog reset
+    if (Checkpoint_WasUnexpectedReset())
+    {
+        Playlist_Resume(0, 0);
+    }
+    else
+    {
+        // Check the pulse path end to end before trusting it with a run
+        Loopback_SelfTest(0, 0);
+    }
     // Start console interface
     Console_Main(); // Does not return
     
     // Unreachable code.
     // SO STUPID: In order for vprintf to work, you need to have a printf with
     // the formats, otherwise the XC8 compiler doesn't build in support for it.
-    printf("%c%s%d%x%lu",0,0,0,0,0L);
+    printf("%c%s%d%x%lu%u%ld",0,0,0,0,0L,0,0L);
 }
 
@@ -24,6 +24,21 @@
 
 #include "menus.h"
 #include "powerlossemu.h"
+#include "telemetry.h"
+#include "profile.h"
+#include "sequence.h"
+#include "playlist.h"
+#include "sync.h"
+#include "brownout.h"
+#include "capture.h"
+#include "dashboard.h"
+#include "checkpoint.h"
+#include "loopback.h"
+#include "gate.h"
+#include "bench.h"
+#include "calibration.h"
+#include "glitch.h"
+#include "ram.h"
 
 splash_t splashScreen =
 {
@@ -42,13 +57,47 @@ splash_t splashScreen =
 };
 
 // All menus need to be externed up here
-extern consoleMenu_t mainMenu;
+extern const consoleMenu_t mainMenu;
+extern const consoleMenu_t playlistMenu;
 
-consoleMenuItem_t mainMenuItems[] = 
+const consoleMenuItem_t mainMenuItems[] = 
 {
     {{"Pulse", "Pulse the power-loss signal"},              NO_SUB_MENU,    PowerLossEmu_PulsePowerLossSignal},  
     {{"Setup", "Setup power-loss emulation parameters"},    NO_SUB_MENU,    PowerLossEmu_Setup},
     {{"Current", "Display current power-loss parameters"},  NO_SUB_MENU,    PowerLossEmu_CurrentSettings},
+    {{"Program", "Select or upload a workload program"},    NO_SUB_MENU,    Sequence_Select},
+    {{"Target", "Stop workloads after N counted pulses"},   NO_SUB_MENU,    PowerLossEmu_SetPulseTarget},
     {{"Run", "Run power-loss emulation workload"},          NO_SUB_MENU,    PowerLossEmu_RunWorkload},
+    {{"Stop", "Stop the background workload"},              NO_SUB_MENU,    PowerLossEmu_Stop},
+    {{"Status", "Show where the running workload is"},      NO_SUB_MENU,    PowerLossEmu_Status},
+    {{"Adjust", "Change the running ramp and length"},      NO_SUB_MENU,    PowerLossEmu_Adjust},
+    {{"Playlist", "Chain workload segments into one run"},  &playlistMenu,  NO_FUNCTION_POINTER},
+    {{"Telemetry", "Setup workload telemetry frames"},      NO_SUB_MENU,    Telemetry_Setup},
+    {{"Profile", "Dump hot path cycle profile"},            NO_SUB_MENU,    Profile_Dump},
+    {{"Latency", "Show worst pulse latency and reset it"},  NO_SUB_MENU,    Profile_Latency},
+    {{"Sync", "Setup multi-board leader/follower sync"},    NO_SUB_MENU,    Sync_Setup},
+    {{"Brownout", "Setup analog brownout profile on RC0"},  NO_SUB_MENU,    Brownout_Setup},
+    {{"Dip", "Play the brownout profile once"},             NO_SUB_MENU,    Brownout_Dip},
+    {{"Capture", "Setup AN0 capture around each pulse"},    NO_SUB_MENU,    Capture_Setup},
+    {{"Download", "Send the held capture in binary"},       NO_SUB_MENU,    Capture_Download},
+    {{"Dashboard", "Setup the live status panel for runs"}, NO_SUB_MENU,    Dashboard_Setup},
+    {{"Checkpoint", "Setup soak checkpoints to flash"},     NO_SUB_MENU,    Checkpoint_Setup},
+    {{"Resume", "Resume the last checkpointed run"},        NO_SUB_MENU,    Playlist_Resume},
+    {{"Loopback", "Setup pulse timing on RB3 for runs"},    NO_SUB_MENU,    Loopback_Setup},
+    {{"Selftest", "Time a short workload through RB3"},     NO_SUB_MENU,    Loopback_SelfTest},
+    {{"Gate", "Setup the DUT busy line on RD2"},            NO_SUB_MENU,    Gate_Setup},
+    {{"Glitch", "Setup the edge pattern for each pulse"},   NO_SUB_MENU,    Glitch_Setup},
+    {{"Bench", "Find the shortest period pulses keep up at"},NO_SUB_MENU,    Bench_Run},
+    {{"Calibrate", "Remeasure the period correction"},      NO_SUB_MENU,    Calibration_Run},
+    {{"Ram", "Show what the big RAM buffers take"},         NO_SUB_MENU,    Ram_PrintBudget},
 };
-consoleMenu_t mainMenu = {{"Main Menu", "This is the main menu."}, mainMenuItems, NO_TOP_MENU, MENU_SIZE(mainMenuItems)};
\ No newline at end of file
+const consoleMenu_t mainMenu = {{"Main Menu", "This is the main menu."}, mainMenuItems, NO_TOP_MENU, MENU_SIZE(mainMenuItems)};
+
+const consoleMenuItem_t playlistMenuItems[] = 
+{
+    {{"Add", "Add current settings as a segment"},          NO_SUB_MENU,    Playlist_Add},
+    {{"Clear", "Remove all segments"},                      NO_SUB_MENU,    Playlist_Clear},
+    {{"Show", "Show playlist segments"},                    NO_SUB_MENU,    Playlist_Show},
+    {{"Run", "Run all segments back to back"},              NO_SUB_MENU,    Playlist_Run},
+};
+const consoleMenu_t playlistMenu = {{"Playlist Menu", "Chain workload segments into one run."}, playlistMenuItems, &mainMenu, MENU_SIZE(playlistMenuItems)};
\ No newline at end of file
@@ -30,6 +30,6 @@
 #define NUM_SPLASH_LINES (12)
 
 extern splash_t splashScreen;
-extern consoleMenu_t mainMenu;
+extern const consoleMenu_t mainMenu;
 
 #endif // MENUS_H
\ No newline at end of file
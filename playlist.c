@@ -0,0 +1,124 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+
+#include "console.h"
+#include "powerlossemu.h"
+#include "playlist.h"
+#include "checkpoint.h"
+
+static workloadSettings_t segments[PLAYLIST_MAX_SEGMENTS];
+static workloadStats_t segmentStats[PLAYLIST_MAX_SEGMENTS];
+static uint8_t numSegments;
+
+functionResult_e Playlist_Add(unsigned int numArgs, int args[])
+{
+    // A running playlist is using the segments in place
+    if (PowerLossEmu_IsRunning())
+    {
+        Console_Print(ANSI_COLOR_RED" Stop the running workload first!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+    if (numSegments >= PLAYLIST_MAX_SEGMENTS)
+    {
+        Console_Print(ANSI_COLOR_RED" Playlist is full!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+
+    // Segments are snapshots of the current settings
+    PowerLossEmu_GetSettings(&segments[numSegments]);
+    Console_Print("Added current settings as segment %d", numSegments);
+    numSegments++;
+
+    return SUCCESS;
+}
+
+functionResult_e Playlist_Clear(unsigned int numArgs, int args[])
+{
+    if (PowerLossEmu_IsRunning())
+    {
+        Console_Print(ANSI_COLOR_RED" Stop the running workload first!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+    numSegments = 0;
+    Console_Print("Playlist cleared");
+
+    return SUCCESS;
+}
+
+functionResult_e Playlist_Show(unsigned int numArgs, int args[])
+{
+    if (numSegments == 0)
+    {
+        Console_Print("Playlist is empty, add segments from the current settings.");
+        return SUCCESS;
+    }
+
+    for (uint8_t i = 0; i < numSegments; i++)
+    {
+        Console_Print("Segment %d:", i);
+        Console_PrintDivider();
+        PowerLossEmu_PrintSettings(&segments[i]);
+    }
+    Console_PrintDivider();
+
+    return SUCCESS;
+}
+
+functionResult_e Playlist_Run(unsigned int numArgs, int args[])
+{
+    if (numSegments == 0)
+    {
+        Console_Print(ANSI_COLOR_RED" Playlist is empty!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+
+    Console_Print("Running %d segment playlist", numSegments);
+
+    return PowerLossEmu_RunSegments(segments, segmentStats, numSegments) ? SUCCESS : ERROR;
+}
+
+// The checkpointed run replaces the playlist, so it can be looked at and run
+// again afterwards
+functionResult_e Playlist_Resume(unsigned int numArgs, int args[])
+{
+    checkpointProgress_t progress;
+    uint32_t pulseTarget;
+
+    // Loading would overwrite the segments out from under a running playlist
+    if (PowerLossEmu_IsRunning())
+    {
+        Console_Print(ANSI_COLOR_RED" A workload is already running, Stop it first!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+    if (!Checkpoint_Load(segments, segmentStats, &numSegments, &pulseTarget, &progress))
+    {
+        Console_Print(ANSI_COLOR_RED" No unfinished run to resume!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+
+    return PowerLossEmu_ResumeSegments(segments, segmentStats, numSegments, &progress, pulseTarget) ? SUCCESS : ERROR;
+}
\ No newline at end of file
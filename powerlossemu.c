@@ -24,19 +24,65 @@
 
 #include <xc.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <math.h>
 
 #include "console.h"
 #include "utils.h"
 #include "powerlossemu.h"
+#include "telemetry.h"
+#include "profile.h"
+#include "sequence.h"
+#include "dds.h"
+#include "pulsecounter.h"
+#include "sync.h"
+#include "sweep.h"
+#include "burst.h"
+#include "brownout.h"
+#include "capture.h"
+#include "dashboard.h"
+#include "checkpoint.h"
+#include "flash.h"
+#include "loopback.h"
+#include "gate.h"
+#include "scheduler.h"
+#include "coverage.h"
+#include "glitch.h"
 
-static uint16_t startPeriod;
-static uint16_t endPeriod;
-static uint16_t rampPeriod;
-static uint16_t rampSteps;
-static uint16_t rampStepSize;
-static uint16_t workloadLength;
-static workloadType_e workloadType;
+static workloadSettings_t settings;
+static workloadSettings_t runSettings;
+static workloadStats_t workloadStats;
+// Stop after exactly this many pulses, counted in hardware (0 = no target)
+static uint32_t pulseTarget;
+// Pulses from before a reset, the hardware counter only saw the rest
+static uint32_t resumedPulses;
+static uint16_t resumes;
+
+// Run state, the run is either in the background or in PowerLossEmu_Launch
+static workloadSettings_t *runSegments;
+static workloadStats_t *runStats;
+static uint8_t runNumSegments;
+static uint8_t runSegment;
+static uint32_t progressStartTime;
+static bool runActive;
+static bool runInBackground;
+static bool dashboard;
+static bool watchdog;
+static bool loopback;
+static bool glitch;
+// The hardware counter sees every low phase of a glitch pattern
+static uint8_t lowsPerPulse = 1;
+
+// Running workload state
+static const workloadSettings_t *activeSettings;
+static workloadStats_t *activeStats;
+static uint16_t currentPeriod;
+static uint16_t currentStep;
+// Segments can run for days, longer than the microsecond uptime lasts
+static uint32_t segmentStartSeconds;
+static uint32_t segmentStartMilliseconds;
+static uint32_t segmentStartPulses;
+static uint32_t periodStartTime;
 
 static arrayOfStrings_t workloadStrings =
 {
@@ -44,27 +90,344 @@ static arrayOfStrings_t workloadStrings =
     ANSI_COLOR_CYAN"Sawtooth-Down"ANSI_COLOR_RESET,
     ANSI_COLOR_CYAN"Sine"ANSI_COLOR_RESET,
     ANSI_COLOR_CYAN"Square"ANSI_COLOR_RESET,
+    ANSI_COLOR_CYAN"Program"ANSI_COLOR_RESET,
+    ANSI_COLOR_CYAN"DDS"ANSI_COLOR_RESET,
+    ANSI_COLOR_CYAN"Chirp"ANSI_COLOR_RESET,
+    ANSI_COLOR_CYAN"Log-Ramp"ANSI_COLOR_RESET,
+    ANSI_COLOR_CYAN"Exp-Ramp"ANSI_COLOR_RESET,
+    ANSI_COLOR_CYAN"Burst"ANSI_COLOR_RESET,
+    ANSI_COLOR_CYAN"Gated"ANSI_COLOR_RESET,
+    ANSI_COLOR_CYAN"Coverage"ANSI_COLOR_RESET,
 };
 
+static arrayOfStrings_t waveformStrings =
+{
+    "Sine",
+    "Sawtooth",
+};
 
+static arrayOfStrings_t gateOrderStrings =
+{
+    "Random",
+    "Sweep",
+    "Coverage",
+};
 
-void PowerLossEmu_Init(void)
+static void PowerLossEmu_CalculateStepSize(workloadSettings_t *workload)
 {
-    startPeriod = 10000;
-    endPeriod = 4000;
-    rampPeriod = 1000;
-    rampSteps = 20;
-    // Calculate step size
-    if (startPeriod > endPeriod)
+    if (workload->rampSteps == 0)
+    {
+        workload->rampStepSize = 0;
+    }
+    else if (workload->startPeriod > workload->endPeriod)
     {
-        rampStepSize = (startPeriod - endPeriod)/rampSteps;
+        workload->rampStepSize = (workload->startPeriod - workload->endPeriod)/workload->rampSteps;
     }
     else
     {
-        rampStepSize = (endPeriod - startPeriod)/rampSteps;
+        workload->rampStepSize = (workload->endPeriod - workload->startPeriod)/workload->rampSteps;
+    }
+}
+
+static void PowerLossEmu_TrackPeriod(void)
+{
+    // A period of zero means pulses are off, it's not part of the range
+    if (currentPeriod == 0)
+    {
+        return;
+    }
+    if (currentPeriod < activeStats->minPeriod)
+    {
+        activeStats->minPeriod = currentPeriod;
+    }
+    if (currentPeriod > activeStats->maxPeriod)
+    {
+        activeStats->maxPeriod = currentPeriod;
+    }
+}
+
+static void PowerLossEmu_StartSegment(const workloadSettings_t *segment, workloadStats_t *stats, uint32_t currentTime)
+{
+    float sineStep;
+    sequenceStatus_e sequenceStatus;
+
+    activeSettings = segment;
+    activeStats = stats;
+    currentStep = 1;
+    currentPeriod = segment->startPeriod;
+    stats->pulses = 0;
+    stats->elapsed = 0;
+    stats->steps = 0;
+    stats->minPeriod = UINT16_MAX;
+    stats->maxPeriod = 0;
+
+    // Sine workload starts off differently.
+    if (segment->workloadType == WORKLOAD_SINE)
+    {
+        sineStep = ((float)currentStep)/((float)segment->rampSteps);
+        currentPeriod = segment->startPeriod + (segment->endPeriod - segment->startPeriod)*(1.0 + (0.5*sinf(2.0*M_PI*sineStep)));
+    }
+    // Programs pick their own starting period, run them up to it so it
+    // can be staged straight away. One that waits before setting a period
+    // starts with pulses off.
+    else if (segment->workloadType == WORKLOAD_PROGRAM)
+    {
+        currentPeriod = 0;
+        Sequence_Start(segment->program, currentTime);
+        for (uint8_t i = 0; i < SEQUENCE_MAX_PROGRAM_LENGTH; i++)
+        {
+            sequenceStatus = Sequence_Service(currentTime, &currentPeriod);
+            if (sequenceStatus == SEQUENCE_PERIOD_CHANGED)
+            {
+                stats->steps++;
+            }
+            if (sequenceStatus != SEQUENCE_RUNNING)
+            {
+                break;
+            }
+        }
+        currentStep = Sequence_GetProgramCounter();
+    }
+    // DDS modulates the compare value itself on every match
+    else if (segment->workloadType == WORKLOAD_DDS)
+    {
+        Dds_Start(segment->startPeriod, segment->modulationDepth, segment->modulationPeriod, (ddsWaveform_e)segment->modulationWaveform);
+    }
+    // Sweeps work out their whole curve up front
+    else if ((segment->workloadType == WORKLOAD_CHIRP) || (segment->workloadType == WORKLOAD_LOG_RAMP) || (segment->workloadType == WORKLOAD_EXP_RAMP))
+    {
+        Sweep_Start(segment->startPeriod, segment->endPeriod, segment->rampSteps, (sweepLaw_e)(segment->workloadType - WORKLOAD_CHIRP));
+        currentPeriod = Sweep_GetPeriod(0);
+    }
+    // Bursts are scheduled from the compare interrupt
+    else if (segment->workloadType == WORKLOAD_BURST)
+    {
+        currentPeriod = Burst_Start(segment->burstPulses, segment->burstSpacing, segment->burstGap, segment->burstVariation);
+    }
+    // Gated pulses wait for the DUT, the comparator has to be off before
+    // INT2 is armed or a match from the last segment counts as a window
+    else if (segment->workloadType == WORKLOAD_GATED)
+    {
+        currentPeriod = 0;
+        Util_SetNewCompareValue(0);
+        Gate_Start(segment->gateOffsetMin, segment->gateOffsetMax, segment->rampSteps, segment->gateHoldoff, (gateOrder_e)segment->gateOrder, segment->sequenceStart);
+    }
+    // Coverage queues a new period for every match
+    else if (segment->workloadType == WORKLOAD_COVERAGE)
+    {
+        currentPeriod = Coverage_Start(segment->startPeriod, segment->endPeriod, segment->sequenceStart);
+    }
+    PowerLossEmu_TrackPeriod();
+
+    segmentStartSeconds = Util_GetSecondUptime();
+    segmentStartMilliseconds = Util_GetMillisecondUptime();
+    segmentStartPulses = Util_GetPulseCount();
+    periodStartTime = currentTime;
+}
+
+// Picks the segment up where the checkpoint left it. Where it was in its
+// ramp or program isn't kept, those start again from the first step.
+// Coverage and gated offsets carry on from their sequence index.
+static void PowerLossEmu_RestoreSegment(const checkpointProgress_t *progress)
+{
+    if (activeSettings->workloadType == WORKLOAD_COVERAGE)
+    {
+        currentPeriod = Coverage_SetIndex(progress->sequenceIndex);
+    }
+    else if (activeSettings->workloadType == WORKLOAD_GATED)
+    {
+        Gate_SetIndex(progress->sequenceIndex);
+    }
+    segmentStartSeconds -= progress->segmentSeconds;
+    segmentStartMilliseconds -= progress->stats.elapsed;
+    segmentStartPulses -= progress->stats.pulses;
+    activeStats->steps = progress->stats.steps;
+    if (progress->stats.minPeriod < activeStats->minPeriod)
+    {
+        activeStats->minPeriod = progress->stats.minPeriod;
+    }
+    if (progress->stats.maxPeriod > activeStats->maxPeriod)
+    {
+        activeStats->maxPeriod = progress->stats.maxPeriod;
+    }
+}
+
+static void PowerLossEmu_EndSegment(void)
+{
+    if (activeSettings->workloadType == WORKLOAD_DDS)
+    {
+        Dds_Stop();
+    }
+    else if (activeSettings->workloadType == WORKLOAD_BURST)
+    {
+        Burst_Stop();
+    }
+    else if (activeSettings->workloadType == WORKLOAD_GATED)
+    {
+        Gate_Stop();
+    }
+    else if (activeSettings->workloadType == WORKLOAD_COVERAGE)
+    {
+        Coverage_Stop();
+    }
+    activeStats->pulses = Util_GetPulseCount() - segmentStartPulses;
+    activeStats->elapsed = Util_GetMillisecondUptime() - segmentStartMilliseconds;
+}
+
+static void PowerLossEmu_StepPeriod(void)
+{
+    float sineStep;
+
+    switch (activeSettings->workloadType)
+    {
+        case WORKLOAD_SAWTOOTH_UP:
+            // Increment our current period by the step size
+            currentPeriod += activeSettings->rampStepSize;
+            // Check if we're past max
+            if (currentPeriod > activeSettings->endPeriod)
+            {
+                // Go back to the beginning
+                currentPeriod = activeSettings->startPeriod;
+            }
+            break;
+        case WORKLOAD_SAWTOOTH_DOWN:
+            // Increment our current period by the step size
+            currentPeriod -= activeSettings->rampStepSize;
+            // Check if we're past max
+            if (currentPeriod < activeSettings->endPeriod)
+            {
+                // Go back to the beginning
+                currentPeriod = activeSettings->startPeriod;
+            }
+            break;
+        case WORKLOAD_SINE:
+        {
+            PROFILE_START(PROFILE_REGION_SINE_STEP);
+            sineStep = ((float)currentStep)/((float)activeSettings->rampSteps);
+            currentPeriod = activeSettings->startPeriod + (activeSettings->endPeriod - activeSettings->startPeriod)*(0.5 + (0.5 * cosf(2.0 * M_PI * sineStep)));
+            PROFILE_STOP(PROFILE_REGION_SINE_STEP);
+            break;
+        }
+        case WORKLOAD_SQUARE:
+            if (currentPeriod == activeSettings->startPeriod)
+            {
+                currentPeriod = activeSettings->endPeriod;
+            }
+            else
+            {
+                currentPeriod = activeSettings->startPeriod;
+            }
+            break;
+        case WORKLOAD_CHIRP:
+        case WORKLOAD_LOG_RAMP:
+        case WORKLOAD_EXP_RAMP:
+            // Wraps back around to the start period after the last step
+            currentPeriod = Sweep_GetPeriod(currentStep);
+            break;
+        default:
+            break;
+    }
+}
+
+// Returns false once the active segment is complete
+static bool PowerLossEmu_ServiceSegment(uint32_t currentTime)
+{
+    sequenceStatus_e sequenceStatus;
+
+    // Programs schedule their own period changes
+    if (activeSettings->workloadType == WORKLOAD_PROGRAM)
+    {
+        sequenceStatus = Sequence_Service(currentTime, &currentPeriod);
+        if (sequenceStatus == SEQUENCE_PERIOD_CHANGED)
+        {
+            Util_StageCompareValue(currentPeriod);
+            activeStats->steps++;
+            PowerLossEmu_TrackPeriod();
+        }
+        else if (sequenceStatus == SEQUENCE_DONE)
+        {
+            return false;
+        }
+        currentStep = Sequence_GetProgramCounter();
+    }
+    // Nothing to step, just follow along for statistics and telemetry
+    else if (activeSettings->workloadType == WORKLOAD_DDS)
+    {
+        currentPeriod = Dds_GetPeriod();
+        PowerLossEmu_TrackPeriod();
+    }
+    // Keep the interrupt supplied with the next burst, count bursts as steps
+    else if (activeSettings->workloadType == WORKLOAD_BURST)
+    {
+        Burst_Service();
+        currentStep = Burst_GetBurstCount();
+        activeStats->steps = currentStep;
+    }
+    // Rearm for the next busy window, count windows pulsed as steps
+    else if (activeSettings->workloadType == WORKLOAD_GATED)
+    {
+        Gate_Service();
+        currentStep = (uint16_t)Gate_GetHits();
+        activeStats->steps = Gate_GetHits();
+    }
+    // Keep the interrupt supplied with points, every point is a step
+    else if (activeSettings->workloadType == WORKLOAD_COVERAGE)
+    {
+        Coverage_Service();
+        currentPeriod = Coverage_GetPeriod();
+        PowerLossEmu_TrackPeriod();
+        // Telemetry frames only have room for the low 16 bits of the index,
+        // the statistics keep all of it
+        currentStep = (uint16_t)Coverage_GetIndex();
+        activeStats->steps = Coverage_GetIndex() - activeSettings->sequenceStart;
+    }
+    // Check if we have to move to a new period step
+    else if ((((currentTime - periodStartTime) / MICROSECONDS_IN_MILLISECONDS) >= activeSettings->rampPeriod) && activeSettings->rampPeriod != 0)
+    {
+        PowerLossEmu_StepPeriod();
+        // Reset the period
+        periodStartTime = Util_GetMicrosecondUptime();
+        // Update the comparator, the new period starts at the next match
+        Util_StageCompareValue(currentPeriod);
+        activeStats->steps++;
+        PowerLossEmu_TrackPeriod();
+        // Increment the step
+        currentStep++;
+        // Check if we rolled over
+        if (currentStep > activeSettings->rampSteps)
+        {
+            currentStep = 1;
+        }
     }
-    workloadLength = 300;
-    workloadType = WORKLOAD_SAWTOOTH_DOWN;
+
+    // Check if we're done with this segment
+    return ((Util_GetSecondUptime() - segmentStartSeconds) < activeSettings->workloadLength);
+}
+
+void PowerLossEmu_Init(void)
+{
+    settings.startPeriod = 10000;
+    settings.endPeriod = 4000;
+    settings.rampPeriod = 1000;
+    settings.rampSteps = 20;
+    // Calculate step size
+    PowerLossEmu_CalculateStepSize(&settings);
+    settings.workloadLength = 300;
+    settings.workloadType = WORKLOAD_SAWTOOTH_DOWN;
+    settings.modulationPeriod = 10000;
+    settings.modulationDepth = 2000;
+    settings.modulationWaveform = DDS_WAVEFORM_SINE;
+    settings.burstPulses = 5;
+    settings.burstSpacing = 100;
+    settings.burstGap = 500;
+    settings.burstVariation = 20;
+    settings.gateOffsetMin = 50;
+    settings.gateOffsetMax = 500;
+    settings.gateHoldoff = 1000;
+    settings.gateOrder = GATE_ORDER_RANDOM;
+    settings.sequenceStart = 0;
+    settings.program = 0;
+    Glitch_Init();
 }
 
 functionResult_e PowerLossEmu_PulsePowerLossSignal(unsigned int numArgs, int args[])
@@ -76,42 +439,104 @@ functionResult_e PowerLossEmu_PulsePowerLossSignal(unsigned int numArgs, int arg
 functionResult_e PowerLossEmu_Setup(unsigned int numArgs, int args[])
 {
     uint16_t tempPeriod;
+    unsigned int tempType;
 
-    PowerLossEmu_CurrentSettings(0, 0);
+    // Arguments: start end rampPeriod rampSteps length type [modPeriod modDepth waveform]
+    //            or for bursts: ... type pulses spacing gap variation
+    //            or gated: ... type minOffset maxOffset holdoff order [index]
+    //            or coverage: ... type index
+    if (numArgs == 0)
+    {
+        PowerLossEmu_CurrentSettings(0, 0);
+    }
     
-    startPeriod = Console_PromptForInt("Enter starting period (us): ");
-    tempPeriod = startPeriod;
-    endPeriod = Console_PromptForInt("Enter ending period (us): ");
-    rampPeriod = Console_PromptForInt("Enter ramp period (ms): ");
-    rampSteps = Console_PromptForInt("Enter number of ramp steps: ");
-    workloadLength = Console_PromptForInt("Enter length of workload (s): ");
+    settings.startPeriod = Console_ArgOrPromptForInt(numArgs, args, 0, "Enter starting period (us): ");
+    tempPeriod = settings.startPeriod;
+    settings.endPeriod = Console_ArgOrPromptForInt(numArgs, args, 1, "Enter ending period (us): ");
+    settings.rampPeriod = Console_ArgOrPromptForInt(numArgs, args, 2, "Enter ramp period (ms): ");
+    settings.rampSteps = Console_ArgOrPromptForInt(numArgs, args, 3, "Enter number of ramp steps: ");
+    settings.workloadLength = Console_ArgOrPromptForLong(numArgs, args, 4, "Enter length of workload (s): ");
 
     Console_Print("Choose a workload setting");
-    Console_Print("[0]-sawtooth-up, [1]-sawtooth-down [2]-sine [3]-square");
-    workloadType = (workloadType_e)((0x3)&Console_PromptForInt("Enter workload type: "));
-
-    // Calculate step size
-    if (startPeriod > endPeriod)
+    Console_Print("[0]-sawtooth-up, [1]-sawtooth-down [2]-sine [3]-square [4]-program [5]-dds");
+    Console_Print("[6]-chirp (linear in frequency) [7]-log ramp [8]-exp ramp [9]-burst [10]-gated");
+    Console_Print("[11]-coverage (every pulse gets a new period spread over start to end)");
+    tempType = Console_ArgOrPromptForInt(numArgs, args, 5, "Enter workload type: ");
+    if (tempType < NUM_WORKLOAD_TYPES)
     {
-        rampStepSize = (startPeriod - endPeriod)/rampSteps;
+        settings.workloadType = (workloadType_e)tempType;
     }
     else
     {
-        rampStepSize = (endPeriod - startPeriod)/rampSteps;
+        Console_Print("Invalid workload type, keeping %s", workloadStrings[(uint8_t)settings.workloadType]);
     }
 
+    if (settings.workloadType == WORKLOAD_DDS)
+    {
+        settings.modulationPeriod = Console_ArgOrPromptForInt(numArgs, args, 6, "Enter modulation period (ms): ");
+        settings.modulationDepth = Console_ArgOrPromptForInt(numArgs, args, 7, "Enter modulation depth (us): ");
+        tempType = Console_ArgOrPromptForInt(numArgs, args, 8, "Enter waveform [0]-sine [1]-sawtooth: ");
+        settings.modulationWaveform = (tempType < NUM_DDS_WAVEFORMS) ? tempType : DDS_WAVEFORM_SINE;
+    }
+    else if (settings.workloadType == WORKLOAD_BURST)
+    {
+        settings.burstPulses = Console_ArgOrPromptForInt(numArgs, args, 6, "Enter pulses per burst: ");
+        settings.burstSpacing = Console_ArgOrPromptForInt(numArgs, args, 7, "Enter spacing within a burst (us): ");
+        if (settings.burstSpacing < BURST_MIN_SPACING_US)
+        {
+            Console_Print("Limiting spacing to %d us", BURST_MIN_SPACING_US);
+            settings.burstSpacing = BURST_MIN_SPACING_US;
+        }
+        settings.burstGap = Console_ArgOrPromptForInt(numArgs, args, 8, "Enter gap between bursts (ms): ");
+        tempType = Console_ArgOrPromptForInt(numArgs, args, 9, "Enter burst-to-burst variation (%): ");
+        settings.burstVariation = (tempType > 100) ? 100 : tempType;
+    }
+    else if (settings.workloadType == WORKLOAD_GATED)
+    {
+        settings.gateOffsetMin = Console_ArgOrPromptForInt(numArgs, args, 6, "Enter minimum offset into busy window (us): ");
+        if (settings.gateOffsetMin < GATE_MIN_OFFSET_US)
+        {
+            Console_Print("Limiting minimum offset to %d us", GATE_MIN_OFFSET_US);
+            settings.gateOffsetMin = GATE_MIN_OFFSET_US;
+        }
+        settings.gateOffsetMax = Console_ArgOrPromptForInt(numArgs, args, 7, "Enter maximum offset into busy window (us): ");
+        if (settings.gateOffsetMax > MAX_COMPARE_PERIOD_US)
+        {
+            Console_Print("Limiting maximum offset to %u us", MAX_COMPARE_PERIOD_US);
+            settings.gateOffsetMax = MAX_COMPARE_PERIOD_US;
+        }
+        if (settings.gateOffsetMax < settings.gateOffsetMin)
+        {
+            settings.gateOffsetMax = settings.gateOffsetMin;
+        }
+        settings.gateHoldoff = Console_ArgOrPromptForInt(numArgs, args, 8, "Enter holdoff after a pulse (ms): ");
+        tempType = Console_ArgOrPromptForInt(numArgs, args, 9, "Enter offset order [0]-random [1]-sweep over ramp steps [2]-coverage: ");
+        settings.gateOrder = (tempType < NUM_GATE_ORDERS) ? tempType : GATE_ORDER_RANDOM;
+        if (settings.gateOrder == GATE_ORDER_COVERAGE)
+        {
+            settings.sequenceStart = Console_ArgOrPromptForLong(numArgs, args, 10, "Enter starting sequence index (0 for a new campaign): ");
+        }
+    }
+    else if (settings.workloadType == WORKLOAD_COVERAGE)
+    {
+        settings.sequenceStart = Console_ArgOrPromptForLong(numArgs, args, 6, "Enter starting sequence index (0 for a new campaign): ");
+    }
+
+    // Calculate step size
+    PowerLossEmu_CalculateStepSize(&settings);
+
     // For some workloads, swap periods if they don't make sense
-    if (((workloadType == WORKLOAD_SAWTOOTH_UP) || (workloadType == WORKLOAD_SINE)) && (startPeriod > endPeriod))
+    if (((settings.workloadType == WORKLOAD_SAWTOOTH_UP) || (settings.workloadType == WORKLOAD_SINE)) && (settings.startPeriod > settings.endPeriod))
     {
         Console_Print("Swapping periods");
-        startPeriod = endPeriod;
-        endPeriod = tempPeriod;
+        settings.startPeriod = settings.endPeriod;
+        settings.endPeriod = tempPeriod;
     }
-    else if ((workloadType == WORKLOAD_SAWTOOTH_DOWN) && (startPeriod < endPeriod))
+    else if ((settings.workloadType == WORKLOAD_SAWTOOTH_DOWN) && (settings.startPeriod < settings.endPeriod))
     {
         Console_Print("Swapping periods");
-        startPeriod = endPeriod;
-        endPeriod = tempPeriod;
+        settings.startPeriod = settings.endPeriod;
+        settings.endPeriod = tempPeriod;
     }
 
     PowerLossEmu_CurrentSettings(0, 0);
@@ -119,132 +544,693 @@ functionResult_e PowerLossEmu_Setup(unsigned int numArgs, int args[])
     return SUCCESS;
 }
 
+void PowerLossEmu_GetSettings(workloadSettings_t *workload)
+{
+    *workload = settings;
+}
+
+// Sequence_Select keeps its choice with the rest of the settings, so every
+// snapshot runs the program it was taken with
+void PowerLossEmu_SetProgram(uint8_t program)
+{
+    settings.program = program;
+}
+
+uint8_t PowerLossEmu_GetProgram(void)
+{
+    return settings.program;
+}
+
+void PowerLossEmu_PrintSettings(const workloadSettings_t *workload)
+{
+    Console_Print("Start period:    %6d us", workload->startPeriod);
+    Console_Print("End period:      %6d us", workload->endPeriod);
+    Console_Print("Ramp period:     %6d ms", workload->rampPeriod);
+    Console_Print("Ramp steps:      %6d", workload->rampSteps);
+    if ((workload->workloadType == WORKLOAD_SAWTOOTH_UP) || (workload->workloadType == WORKLOAD_SAWTOOTH_DOWN))
+    {
+        Console_Print("Ramp step size:  %6d", workload->rampStepSize);
+    }
+    Console_Print("Workload length: %6lu s", workload->workloadLength);
+    Console_Print("Workload type:   %s", workloadStrings[(uint8_t)workload->workloadType]);
+    if (workload->workloadType == WORKLOAD_PROGRAM)
+    {
+        Console_Print("Program:         %s", Sequence_GetProgramName(workload->program));
+    }
+    else if (workload->workloadType == WORKLOAD_DDS)
+    {
+        Console_Print("Mod. period:     %6u ms", workload->modulationPeriod);
+        Console_Print("Mod. depth:      %6u us", workload->modulationDepth);
+        Console_Print("Mod. waveform:   %s", waveformStrings[workload->modulationWaveform]);
+    }
+    else if (workload->workloadType == WORKLOAD_BURST)
+    {
+        Console_Print("Burst pulses:    %6u", workload->burstPulses);
+        Console_Print("Burst spacing:   %6u us", workload->burstSpacing);
+        Console_Print("Burst gap:       %6u ms", workload->burstGap);
+        Console_Print("Burst variation: %6u %%", workload->burstVariation);
+    }
+    else if (workload->workloadType == WORKLOAD_GATED)
+    {
+        Console_Print("Offset min:      %6u us", workload->gateOffsetMin);
+        Console_Print("Offset max:      %6u us", workload->gateOffsetMax);
+        Console_Print("Holdoff:         %6u ms", workload->gateHoldoff);
+        Console_Print("Offset order:    %s", gateOrderStrings[workload->gateOrder]);
+        if (workload->gateOrder == GATE_ORDER_COVERAGE)
+        {
+            Console_Print("Start index:     %6lu", workload->sequenceStart);
+        }
+    }
+    else if (workload->workloadType == WORKLOAD_COVERAGE)
+    {
+        Console_Print("Start index:     %6lu", workload->sequenceStart);
+    }
+}
+
 functionResult_e PowerLossEmu_CurrentSettings(unsigned int numArgs, int args[])
 {
     Console_Print("Current power loss emulation settings:");
     Console_PrintDivider();
-    Console_Print("Start period:    %6d us", startPeriod);
-    Console_Print("End period:      %6d us", endPeriod);
-    Console_Print("Ramp period:     %6d ms", rampPeriod);
-    Console_Print("Ramp steps:      %6d", rampSteps, rampSteps);
-    if ((workloadType == WORKLOAD_SAWTOOTH_UP) || (workloadType == WORKLOAD_SAWTOOTH_DOWN))
+    PowerLossEmu_PrintSettings(&settings);
+    if (pulseTarget != 0)
     {
-        Console_Print("Ramp step size:  %6d", rampStepSize);
+        Console_Print("Pulse target:    %6lu", pulseTarget);
     }
-    Console_Print("Workload length: %6d s", workloadLength);
-    Console_Print("Workload type:   %s", workloadStrings[(uint8_t)workloadType]);
     Console_PrintDivider();
 
     return SUCCESS;
 }
 
-functionResult_e PowerLossEmu_RunWorkload(unsigned int numArgs, int args[])
+void PowerLossEmu_PrintStats(const workloadSettings_t segments[], const workloadStats_t stats[], uint8_t numSegments)
 {
-    uint16_t currentPeriod = startPeriod;
-    uint32_t workloadStartTime;
-    uint32_t periodStartTime;
-    uint32_t progressStartTime;
-    uint32_t currentTime;
-    uint8_t currentStep = 1;
-    float sineStep;
+    Console_Print("Workload statistics:");
+    Console_PrintDivider();
+    Console_Print("Seg   Time (ms)     Pulses  Steps  Min (us)  Max (us)  Type");
+    for (uint8_t i = 0; i < numSegments; i++)
+    {
+        Console_Print("%3d  %10lu %10lu %6lu    %6u    %6u  %s", i, stats[i].elapsed, stats[i].pulses, stats[i].steps,
+                      stats[i].minPeriod, stats[i].maxPeriod, workloadStrings[(uint8_t)segments[i].workloadType]);
+    }
+    Console_PrintDivider();
+}
 
-    PowerLossEmu_CurrentSettings(0, 0);
-    Console_Print("Workload will pulse RB0, running...");
+static uint32_t PowerLossEmu_GetCountedPulses(void)
+{
+    return resumedPulses + (PulseCounter_GetCount() / lowsPerPulse);
+}
 
-    // Sine workload starts off differently.
-    if (workloadType == WORKLOAD_SINE)
+static void PowerLossEmu_UpdateDashboard(uint8_t segment)
+{
+    uint32_t elapsed = Util_GetSecondUptime() - segmentStartSeconds;
+
+    Dashboard_Set(DASHBOARD_FIELD_SEGMENT, segment);
+    Dashboard_Set(DASHBOARD_FIELD_PERIOD, currentPeriod);
+    Dashboard_Set(DASHBOARD_FIELD_STEP, currentStep);
+    Dashboard_Set(DASHBOARD_FIELD_ELAPSED, elapsed);
+    Dashboard_Set(DASHBOARD_FIELD_REMAINING, (elapsed < activeSettings->workloadLength) ? (activeSettings->workloadLength - elapsed) : 0);
+    Dashboard_Set(DASHBOARD_FIELD_PULSES, Util_GetPulseCount());
+    // Pulses generated but never seen on RB3, only known with a target armed
+    Dashboard_Set(DASHBOARD_FIELD_COUNT_ERROR, (pulseTarget != 0) ? (int32_t)(Util_GetPulseCount() - PowerLossEmu_GetCountedPulses()) : 0);
+    Dashboard_Set(DASHBOARD_FIELD_SYNC_SKEW, Sync_GetSkew());
+}
+
+static void PowerLossEmu_VerifyPulseTarget(void)
+{
+    uint32_t hardwareCount = PowerLossEmu_GetCountedPulses();
+
+    PulseCounter_Disarm();
+    Console_Print("Pulse target:    %10lu", pulseTarget);
+    Console_Print("Hardware count:  %10lu", hardwareCount);
+    Console_Print("Software count:  %10lu", Util_GetPulseCount());
+    if ((hardwareCount == 0) && (Util_GetPulseCount() != 0))
+    {
+        Console_Print(ANSI_COLOR_RED" No pulses counted, is RB0 jumpered to RB3?"ANSI_COLOR_RESET);
+    }
+    else if (PulseCounter_IsDone() && (hardwareCount != pulseTarget))
+    {
+        Console_Print(ANSI_COLOR_RED" Hardware count doesn't match the target!"ANSI_COLOR_RESET);
+    }
+    else if (PulseCounter_IsDone())
+    {
+        Console_Print(ANSI_COLOR_GREEN" Pulse target reached exactly"ANSI_COLOR_RESET);
+    }
+}
+
+functionResult_e PowerLossEmu_SetPulseTarget(unsigned int numArgs, int args[])
+{
+    // The counter is armed for the target at the start of a run
+    if (runActive)
+    {
+        Console_Print(ANSI_COLOR_RED" Stop the running workload first!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+    // Arguments: target
+    Console_Print("Workloads stop after N pulses counted on RB3 (jumper from RB0), 0 = off");
+    pulseTarget = Console_ArgOrPromptForLong(numArgs, args, 0, "Enter pulse target: ");
+    if (pulseTarget == 0)
+    {
+        Console_Print("Pulse target off");
+    }
+    else
+    {
+        Console_Print("Workloads will stop after %lu pulses", pulseTarget);
+    }
+
+    return SUCCESS;
+}
+
+// Where a coverage or gated campaign is in its sequence
+static uint32_t PowerLossEmu_GetSequenceIndex(void)
+{
+    if (activeSettings->workloadType == WORKLOAD_COVERAGE)
+    {
+        return Coverage_GetIndex();
+    }
+    if (activeSettings->workloadType == WORKLOAD_GATED)
     {
-        sineStep = ((float)currentStep)/((float)rampSteps);
-        currentPeriod = startPeriod + (endPeriod - startPeriod)*(1.0 + (0.5*sinf(2.0*M_PI*sineStep)));
+        return Gate_GetIndex();
     }
 
+    return 0;
+}
+
+static void PowerLossEmu_SaveCheckpoint(uint8_t segment, uint32_t currentSeconds)
+{
+    checkpointProgress_t progress;
+
+    progress.segment = segment;
+    progress.resumes = resumes;
+    progress.totalPulses = Util_GetPulseCount();
+    progress.segmentSeconds = currentSeconds - segmentStartSeconds;
+    progress.sequenceIndex = PowerLossEmu_GetSequenceIndex();
+    progress.stats = *activeStats;
+    progress.stats.pulses = progress.totalPulses - segmentStartPulses;
+    progress.stats.elapsed = Util_GetMillisecondUptime() - segmentStartMilliseconds;
+    Checkpoint_Save(&progress, currentSeconds);
+}
+
+// Sets up the segments from the start, or from a checkpoint if resume is
+// set. PowerLossEmu_Step then services the run until it's over.
+static void PowerLossEmu_Begin(workloadSettings_t segments[], workloadStats_t stats[], uint8_t numSegments, const checkpointProgress_t *resume)
+{
+    uint32_t currentTime;
+
+    runSegments = segments;
+    runStats = stats;
+    runNumSegments = numSegments;
+    runSegment = 0;
+
+    // Followers measure their phase with TMR3, which a pattern keeps
+    // resetting, so synced runs stick to the single pulse
+    glitch = Glitch_IsEnabled() && !Sync_IsEnabled();
+    lowsPerPulse = glitch ? Glitch_GetLowsPerPulse() : 1;
+
     // Initialize the comparator
-    Util_SetNewCompareValue(currentPeriod);
-    workloadStartTime = Util_GetMicrosecondUptime();
-    periodStartTime = workloadStartTime;
-    progressStartTime = workloadStartTime;
-    for(;;)
+    resumedPulses = (resume != 0) ? resume->totalPulses : 0;
+    pulseCount = resumedPulses;
+    if (pulseTarget > resumedPulses)
     {
-        currentTime = Util_GetMicrosecondUptime();
-        // Check if we have to move to a new period step
-        if ((((currentTime - periodStartTime) / MICROSECONDS_IN_MILLISECONDS) >= rampPeriod) && rampPeriod != 0)
-        {
-            switch (workloadType)
-            {
-                case WORKLOAD_SAWTOOTH_UP:
-                    // Increment our current period by the step size
-                    currentPeriod += rampStepSize;
-                    // Check if we're past max
-                    if (currentPeriod > endPeriod)
-                    {
-                        // Go back to the beginning
-                        currentPeriod = startPeriod;
-                    }
-                    break;
-                case WORKLOAD_SAWTOOTH_DOWN:
-                    // Increment our current period by the step size
-                    currentPeriod -= rampStepSize;
-                    // Check if we're past max
-                    if (currentPeriod < endPeriod)
-                    {
-                        // Go back to the beginning
-                        currentPeriod = startPeriod;
-                    }
-                    break;
-                case WORKLOAD_SINE:
-                    sineStep = ((float)currentStep)/((float)rampSteps);
-                    currentPeriod = startPeriod + (endPeriod - startPeriod)*(0.5 + (0.5 * cosf(2.0 * M_PI * sineStep)));
-                    break;
-                case WORKLOAD_SQUARE:
-                    if (currentPeriod == startPeriod)
-                    {
-                        currentPeriod = endPeriod;
-                    }
-                    else
-                    {
-                        currentPeriod = startPeriod;
-                    }
-                    break;
-                default:
-                    break;
-            }
-            // Reset the period
-            periodStartTime = Util_GetMicrosecondUptime();
-            // Update the comparator
-            Util_SetNewCompareValue(currentPeriod);
-            // Increment the step
-            currentStep++;
-            // Check if we rolled over
-            if (currentStep > rampSteps)
-            {
-                currentStep = 1;
-            }
-        }
-        
-        // Print progress every seconds
-        if (((currentTime - progressStartTime) / MICROSECONDS_IN_SECONDS) > 0)
+        // Arm before the first match so every pulse is counted
+        PulseCounter_Arm((pulseTarget - resumedPulses) * lowsPerPulse);
+    }
+    currentTime = Util_GetMicrosecondUptime();
+    if (resume != 0)
+    {
+        runSegment = resume->segment;
+    }
+    Gate_ClearStats();
+    PowerLossEmu_StartSegment(&segments[runSegment], &stats[runSegment], currentTime);
+    if (resume != 0)
+    {
+        PowerLossEmu_RestoreSegment(resume);
+    }
+    // The loopback has to be listening before the first match. It needs
+    // ECCP2, otherwise brownouts run on it alongside the pulses. It times
+    // one edge per match, so not with a pattern.
+    loopback = Loopback_IsEnabled() && !glitch;
+    if (loopback)
+    {
+        Loopback_Start();
+    }
+    if (glitch)
+    {
+        Glitch_Start();
+    }
+    Sync_StartCompare(currentPeriod);
+    if (!loopback && Brownout_IsLinkedToWorkloads())
+    {
+        Brownout_Start(true);
+    }
+    progressStartTime = currentTime;
+    if (Telemetry_IsEnabled())
+    {
+        Telemetry_Start(currentTime);
+    }
+    Capture_Start();
+    // The dashboard only gets the link when nothing binary is using it
+    dashboard = Dashboard_IsEnabled() && !Capture_IsStreaming() && !Telemetry_IsEnabled();
+    if (dashboard)
+    {
+        Dashboard_Start(currentTime);
+    }
+    // The watchdog (about 131 s) brings a hung run back through a reset,
+    // only worth it if there's a checkpoint to resume from
+    watchdog = Checkpoint_IsEnabled();
+    if (watchdog)
+    {
+        CLRWDT();
+        WDTCONbits.SWDTEN = 1;  // 0b1 = Watchdog Timer is on
+    }
+    runActive = true;
+}
+
+// Services the run once, returns false once it's over
+static bool PowerLossEmu_Step(void)
+{
+    uint32_t currentTime;
+    uint32_t currentSeconds;
+    bool running = true;
+
+    PROFILE_START(PROFILE_REGION_WORKLOAD_ITERATION);
+    CLRWDT();
+    currentTime = Util_GetMicrosecondUptime();
+    currentSeconds = Util_GetSecondUptime();
+    // The counter has already stopped the comparator for us
+    if ((pulseTarget != 0) && PulseCounter_IsDone())
+    {
+        running = false;
+    }
+    // Followers end the run when the leader does
+    else if (!Sync_Service())
+    {
+        running = false;
+    }
+    else if (!PowerLossEmu_ServiceSegment(currentTime))
+    {
+        if ((runSegment + 1) >= runNumSegments)
         {
-            Console_PrintNoEol(".");
-            progressStartTime = Util_GetMicrosecondUptime();
+            running = false;
         }
-        
-        // Check if we're done our workload
-        if (((currentTime - workloadStartTime) / MICROSECONDS_IN_SECONDS) >= workloadLength)
+        else
         {
-            break;
+            PowerLossEmu_EndSegment();
+            Checkpoint_SegmentDone(runSegment);
+            runSegment++;
+            // Move on without stopping the comparator, the new period takes
+            // over at the next compare match. Only a segment that starts with
+            // pulses off (gated, or a program waiting before its first
+            // period) stops it.
+            PowerLossEmu_StartSegment(&runSegments[runSegment], &runStats[runSegment], currentTime);
+            Util_StageCompareValue(currentPeriod);
         }
-        
+    }
+    if (!running)
+    {
+        PowerLossEmu_EndSegment();
+        PROFILE_STOP(PROFILE_REGION_WORKLOAD_ITERATION);
+        return false;
+    }
+
+    // Checkpoints are queued here and written once there's a long enough
+    // gap before the next pulse
+    if (Checkpoint_IsDue(currentSeconds))
+    {
+        PowerLossEmu_SaveCheckpoint(runSegment, currentSeconds);
+    }
+    Checkpoint_Service();
+    if (loopback)
+    {
+        Loopback_Service();
+    }
+
+    // Stream captures, telemetry frames, refresh the dashboard or
+    // print progress every seconds (only when the console is ours)
+    if (Capture_IsStreaming())
+    {
+        Capture_Service();
+    }
+    else if (Telemetry_IsEnabled())
+    {
+        Telemetry_Service(currentTime, currentPeriod, currentStep);
+    }
+    else if (dashboard)
+    {
+        PowerLossEmu_UpdateDashboard(runSegment);
+        Dashboard_Service(currentTime);
+    }
+    else if (!runInBackground && (((currentTime - progressStartTime) / MICROSECONDS_IN_SECONDS) > 0))
+    {
+        Console_PrintNoEol(".");
+        progressStartTime = Util_GetMicrosecondUptime();
+    }
+
+    PROFILE_STOP(PROFILE_REGION_WORKLOAD_ITERATION);
+
+    return true;
+}
+
+// Tears the run down once the active segment has been ended
+static void PowerLossEmu_Finish(void)
+{
+    // Disable power-loss pulse
+    Util_SetNewCompareValue(0);
+    if (watchdog)
+    {
+        WDTCONbits.SWDTEN = 0;  // 0b0 = Watchdog Timer is off
+    }
+    Sync_Stop();
+    if (glitch)
+    {
+        Glitch_Stop();
+    }
+    if (loopback)
+    {
+        Loopback_Stop();
+    }
+    else if (Brownout_IsLinkedToWorkloads())
+    {
+        Brownout_Stop();
+    }
+    Capture_Stop();
+    if (Telemetry_IsEnabled())
+    {
+        Telemetry_Stop();
+    }
+    if (dashboard)
+    {
+        Dashboard_Stop();
+    }
+    Checkpoint_SegmentDone(runSegment);
+    Checkpoint_End();
+    runActive = false;
+    Console_PrintNewLine();
+    Sync_PrintStats();
+    Gate_PrintStats();
+    if (glitch)
+    {
+        Glitch_PrintStats();
+    }
+    if (loopback)
+    {
+        Loopback_PrintStats();
+    }
+    if (pulseTarget != 0)
+    {
+        PowerLossEmu_VerifyPulseTarget();
+    }
+    // Set this as the start index to carry the campaign on
+    if ((activeSettings->workloadType == WORKLOAD_COVERAGE) ||
+        ((activeSettings->workloadType == WORKLOAD_GATED) && (activeSettings->gateOrder == GATE_ORDER_COVERAGE)))
+    {
+        Console_Print("Next sequence index: %lu", PowerLossEmu_GetSequenceIndex());
+    }
+    Console_Print("Workload exiting!");
+    PowerLossEmu_PrintStats(runSegments, runStats, runSegment + 1);
+}
+
+// Scheduled while the run is in the background
+static bool PowerLossEmu_BackgroundTask(void)
+{
+    if (!PowerLossEmu_Step())
+    {
+        PowerLossEmu_Finish();
+        return false;
+    }
+
+    return true;
+}
+
+// Runs in the background with the console still up unless the console link
+// is taken by binary streams or the dashboard, then it's run here until
+// it's over or a key is pressed
+static void PowerLossEmu_Launch(void)
+{
+    runInBackground = !dashboard && !Capture_IsStreaming() && !Telemetry_IsEnabled();
+    if (runInBackground && Scheduler_Add(PowerLossEmu_BackgroundTask))
+    {
+        Console_Print("Workload will pulse RB0, running in the background. Use Stop to end it.");
+        return;
+    }
+
+    runInBackground = false;
+    Console_Print("Workload will pulse RB0, running... (any key stops it)");
+    while (PowerLossEmu_Step())
+    {
         // Check if we're quitting early
         if (Console_CheckForKey() != 0)
         {
-            
+            PowerLossEmu_EndSegment();
             break;
         }
     }
-    Console_PrintNewLine();
-    // Disable power-loss pulse
-    Util_SetNewCompareValue(0);
-    Console_Print("Workload exiting!");
+    PowerLossEmu_Finish();
+}
+
+bool PowerLossEmu_IsRunning(void)
+{
+    return runActive;
+}
+
+// Program segments can only run if their program is still there
+static bool PowerLossEmu_ProgramsLoaded(const workloadSettings_t segments[], uint8_t numSegments)
+{
+    for (uint8_t i = 0; i < numSegments; i++)
+    {
+        if ((segments[i].workloadType == WORKLOAD_PROGRAM) && !Sequence_IsLoaded(segments[i].program))
+        {
+            Console_Print(ANSI_COLOR_RED" Segment %d's %s program isn't loaded, upload it again!"ANSI_COLOR_RESET, i,
+                          Sequence_GetProgramName(segments[i].program));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Followers keep the period they were started with and only line up its
+// phase, so a synced run has to hold one period for its whole length
+static bool PowerLossEmu_IsFixedPeriod(const workloadSettings_t *segment, uint16_t period)
+{
+    switch (segment->workloadType)
+    {
+        case WORKLOAD_SAWTOOTH_UP:
+        case WORKLOAD_SAWTOOTH_DOWN:
+        case WORKLOAD_SINE:
+        case WORKLOAD_SQUARE:
+        case WORKLOAD_CHIRP:
+        case WORKLOAD_LOG_RAMP:
+        case WORKLOAD_EXP_RAMP:
+            return (segment->startPeriod != 0) && (segment->startPeriod == segment->endPeriod) && (segment->startPeriod == period);
+        default:
+            return false;
+    }
+}
+
+static bool PowerLossEmu_SyncAllowed(const workloadSettings_t segments[], uint8_t numSegments)
+{
+    if (!Sync_IsEnabled())
+    {
+        return true;
+    }
+    for (uint8_t i = 0; i < numSegments; i++)
+    {
+        if (!PowerLossEmu_IsFixedPeriod(&segments[i], segments[0].startPeriod))
+        {
+            Console_Print(ANSI_COLOR_RED" Synced runs need the same fixed period (start = end) in every segment, segment %d changes it!"ANSI_COLOR_RESET, i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Checkpoints are only written with more than FLASH_WRITE_BUDGET_US to the
+// next pulse. Programs, bursts and gated segments may leave a long enough
+// gap, the rest never go past their longest period.
+static void PowerLossEmu_CheckCheckpointGaps(const workloadSettings_t segments[], uint8_t numSegments)
+{
+    uint16_t longestPeriod;
+
+    if (!Checkpoint_IsEnabled())
+    {
+        return;
+    }
+    for (uint8_t i = 0; i < numSegments; i++)
+    {
+        switch (segments[i].workloadType)
+        {
+            case WORKLOAD_PROGRAM:
+            case WORKLOAD_BURST:
+            case WORKLOAD_GATED:
+                return;
+            case WORKLOAD_DDS:
+                longestPeriod = segments[i].startPeriod + segments[i].modulationDepth;
+                break;
+            default:
+                longestPeriod = (segments[i].startPeriod > segments[i].endPeriod) ? segments[i].startPeriod : segments[i].endPeriod;
+                break;
+        }
+        if (longestPeriod > FLASH_WRITE_BUDGET_US)
+        {
+            return;
+        }
+    }
+    Console_Print(ANSI_COLOR_RED" No period is over %d ms, checkpoints won't be written and the run can't be resumed!"ANSI_COLOR_RESET,
+                  FLASH_WRITE_BUDGET_US / MICROSECONDS_IN_MILLISECONDS);
+}
+
+// Returns whether the run was started, statistics are printed at the end
+bool PowerLossEmu_RunSegments(workloadSettings_t segments[], workloadStats_t stats[], uint8_t numSegments)
+{
+    if (runActive)
+    {
+        Console_Print(ANSI_COLOR_RED" A workload is already running, Stop it first!"ANSI_COLOR_RESET);
+        return false;
+    }
+    if (!PowerLossEmu_ProgramsLoaded(segments, numSegments) || !PowerLossEmu_SyncAllowed(segments, numSegments))
+    {
+        return false;
+    }
+    // Followers sit here until the leader starts the run
+    if (!Sync_WaitForStart())
+    {
+        Console_Print("Workload cancelled!");
+        return false;
+    }
+
+    PowerLossEmu_CheckCheckpointGaps(segments, numSegments);
+    resumes = 0;
+    Checkpoint_Begin(segments, stats, numSegments, pulseTarget);
+    PowerLossEmu_Begin(segments, stats, numSegments, 0);
+    PowerLossEmu_Launch();
+
+    return true;
+}
+
+// Carries on a run from a checkpoint after a reset, the pulse target comes
+// back with it
+bool PowerLossEmu_ResumeSegments(workloadSettings_t segments[], workloadStats_t stats[], uint8_t numSegments, const checkpointProgress_t *progress, uint32_t target)
+{
+    if (runActive)
+    {
+        Console_Print(ANSI_COLOR_RED" A workload is already running, Stop it first!"ANSI_COLOR_RESET);
+        return false;
+    }
+    if (!PowerLossEmu_ProgramsLoaded(segments, numSegments) || !PowerLossEmu_SyncAllowed(segments, numSegments))
+    {
+        return false;
+    }
+
+    pulseTarget = target;
+    resumes = progress->resumes + 1;
+    Console_Print("Resuming segment %u of %u, %lu s in, %lu pulses so far (resume %u)", progress->segment, numSegments,
+                  progress->segmentSeconds, progress->totalPulses, resumes);
+    PowerLossEmu_CheckCheckpointGaps(segments, numSegments);
+    Checkpoint_Continue(stats);
+    PowerLossEmu_Begin(segments, stats, numSegments, progress);
+    PowerLossEmu_Launch();
+
+    return true;
+}
+
+functionResult_e PowerLossEmu_RunWorkload(unsigned int numArgs, int args[])
+{
+    // The copy is the live segment of a running workload
+    if (runActive)
+    {
+        Console_Print(ANSI_COLOR_RED" A workload is already running, Stop it first!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+    PowerLossEmu_CurrentSettings(0, 0);
+    // Run a copy so Setup can't change the workload under it
+    runSettings = settings;
+
+    return PowerLossEmu_RunSegments(&runSettings, &workloadStats, 1) ? SUCCESS : ERROR;
+}
+
+functionResult_e PowerLossEmu_Stop(unsigned int numArgs, int args[])
+{
+    if (!runActive)
+    {
+        Console_Print(ANSI_COLOR_RED" No workload is running!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+
+    Scheduler_Remove(PowerLossEmu_BackgroundTask);
+    PowerLossEmu_EndSegment();
+    PowerLossEmu_Finish();
+
+    return SUCCESS;
+}
+
+functionResult_e PowerLossEmu_Status(unsigned int numArgs, int args[])
+{
+    uint32_t elapsed;
+
+    if (!runActive)
+    {
+        Console_Print("No workload is running");
+        return SUCCESS;
+    }
+
+    elapsed = Util_GetSecondUptime() - segmentStartSeconds;
+    Console_Print("Segment:         %6u of %u (%s)", runSegment, runNumSegments, workloadStrings[(uint8_t)activeSettings->workloadType]);
+    Console_Print("Step:            %6u", currentStep);
+    Console_Print("Period:          %6u us", currentPeriod);
+    Console_Print("Elapsed:         %6lu s", elapsed);
+    Console_Print("Remaining:       %6lu s", (elapsed < activeSettings->workloadLength) ? (activeSettings->workloadLength - elapsed) : 0);
+    Console_Print("Segment pulses:  %6lu", Util_GetPulseCount() - segmentStartPulses);
+    Console_Print("Total pulses:    %6lu", Util_GetPulseCount());
+    if ((activeSettings->workloadType == WORKLOAD_COVERAGE) || (activeSettings->workloadType == WORKLOAD_GATED))
+    {
+        Console_Print("Sequence index:  %6lu", PowerLossEmu_GetSequenceIndex());
+    }
+
+    return SUCCESS;
+}
+
+// Changes the running segment, ramps pick it up at their next step. Sweeps
+// worked out their curve when they started so only the length applies.
+functionResult_e PowerLossEmu_Adjust(unsigned int numArgs, int args[])
+{
+    workloadSettings_t adjusted;
+    uint8_t segment = runSegment;
+
+    if (!runActive)
+    {
+        Console_Print(ANSI_COLOR_RED" No workload is running!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+
+    // Arguments: end rampPeriod rampSteps length
+    adjusted = runSegments[segment];
+    Console_Print("Adjusting segment %u, currently %u us end period, %u ms ramp period, %u steps, %lu s", segment,
+                  adjusted.endPeriod, adjusted.rampPeriod, adjusted.rampSteps, adjusted.workloadLength);
+    adjusted.endPeriod = Console_ArgOrPromptForInt(numArgs, args, 0, "Enter ending period (us): ");
+    adjusted.rampPeriod = Console_ArgOrPromptForInt(numArgs, args, 1, "Enter ramp period (ms): ");
+    adjusted.rampSteps = Console_ArgOrPromptForInt(numArgs, args, 2, "Enter number of ramp steps: ");
+    adjusted.workloadLength = Console_ArgOrPromptForLong(numArgs, args, 3, "Enter length of workload (s): ");
+    PowerLossEmu_CalculateStepSize(&adjusted);
+
+    // The run kept going while we were prompting
+    if (!runActive || (runSegment != segment))
+    {
+        Console_Print(ANSI_COLOR_RED" The segment ended while adjusting, nothing changed!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+    if ((((adjusted.workloadType == WORKLOAD_SAWTOOTH_UP) || (adjusted.workloadType == WORKLOAD_SINE)) && (adjusted.endPeriod < adjusted.startPeriod)) ||
+        ((adjusted.workloadType == WORKLOAD_SAWTOOTH_DOWN) && (adjusted.endPeriod > adjusted.startPeriod)))
+    {
+        Console_Print(ANSI_COLOR_RED" That end period turns the ramp around!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+    if (Sync_IsEnabled() && !PowerLossEmu_IsFixedPeriod(&adjusted, adjusted.startPeriod))
+    {
+        Console_Print(ANSI_COLOR_RED" Synced runs have to keep a fixed period!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+    runSegments[segment] = adjusted;
+    Console_Print("Segment %u adjusted, checkpoints still resume with the original settings", segment);
 
     return SUCCESS;
 }
\ No newline at end of file
@@ -25,6 +25,9 @@
 #ifndef POWERLOSSEMU_H
 #define POWERLOSSEMU_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
 #include "console.h"
 
 typedef enum
@@ -33,14 +36,76 @@ typedef enum
     WORKLOAD_SAWTOOTH_DOWN = 1,
     WORKLOAD_SINE = 2,
     WORKLOAD_SQUARE = 3,
+    WORKLOAD_PROGRAM = 4,
+    WORKLOAD_DDS = 5,
+    WORKLOAD_CHIRP = 6,
+    WORKLOAD_LOG_RAMP = 7,
+    WORKLOAD_EXP_RAMP = 8,
+    WORKLOAD_BURST = 9,
+    WORKLOAD_GATED = 10,
+    WORKLOAD_COVERAGE = 11,
+    NUM_WORKLOAD_TYPES,
 } workloadType_e;
 
 typedef const char *const arrayOfStrings_t[];
 
+typedef struct workloadSettings
+{
+    uint16_t            startPeriod;
+    uint16_t            endPeriod;
+    uint16_t            rampPeriod;
+    uint16_t            rampSteps;
+    uint16_t            rampStepSize;
+    uint32_t            workloadLength;     // s
+    workloadType_e      workloadType;
+    // DDS modulation around startPeriod
+    uint16_t            modulationPeriod;   // ms
+    uint16_t            modulationDepth;    // us
+    uint8_t             modulationWaveform;
+    // Bursts of pulses separated by quiet gaps
+    uint16_t            burstPulses;
+    uint16_t            burstSpacing;       // us
+    uint16_t            burstGap;           // ms
+    uint8_t             burstVariation;     // %
+    // Pulses inside DUT busy windows, rampSteps is the number of sweep steps
+    uint16_t            gateOffsetMin;      // us
+    uint16_t            gateOffsetMax;      // us
+    uint16_t            gateHoldoff;        // ms
+    uint8_t             gateOrder;
+    // Coverage workloads and coverage gated offsets start from this index
+    uint32_t            sequenceStart;
+    // Program workloads run this sequence selection
+    uint8_t             program;
+} workloadSettings_t;
+
+typedef struct workloadStats
+{
+    uint32_t            pulses;
+    uint32_t            elapsed;    // ms
+    uint32_t            steps;
+    uint16_t            minPeriod;
+    uint16_t            maxPeriod;
+} workloadStats_t;
+
+// Defined in checkpoint.h, which needs the types above
+struct checkpointProgress;
+
 void PowerLossEmu_Init(void);
 functionResult_e PowerLossEmu_PulsePowerLossSignal(unsigned int numArgs, int args[]);
 functionResult_e PowerLossEmu_Setup(unsigned int numArgs, int args[]);
 functionResult_e PowerLossEmu_CurrentSettings(unsigned int numArgs, int args[]);
 functionResult_e PowerLossEmu_RunWorkload(unsigned int numArgs, int args[]);
+functionResult_e PowerLossEmu_SetPulseTarget(unsigned int numArgs, int args[]);
+functionResult_e PowerLossEmu_Stop(unsigned int numArgs, int args[]);
+functionResult_e PowerLossEmu_Status(unsigned int numArgs, int args[]);
+functionResult_e PowerLossEmu_Adjust(unsigned int numArgs, int args[]);
+void PowerLossEmu_GetSettings(workloadSettings_t *workload);
+void PowerLossEmu_SetProgram(uint8_t program);
+uint8_t PowerLossEmu_GetProgram(void);
+void PowerLossEmu_PrintSettings(const workloadSettings_t *workload);
+void PowerLossEmu_PrintStats(const workloadSettings_t segments[], const workloadStats_t stats[], uint8_t numSegments);
+bool PowerLossEmu_IsRunning(void);
+bool PowerLossEmu_RunSegments(workloadSettings_t segments[], workloadStats_t stats[], uint8_t numSegments);
+bool PowerLossEmu_ResumeSegments(workloadSettings_t segments[], workloadStats_t stats[], uint8_t numSegments, const struct checkpointProgress *progress, uint32_t target);
 
 #endif // POWERLOSSEMU_H
\ No newline at end of file
@@ -0,0 +1,138 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+
+#include "console.h"
+#include "init.h"
+#include "utils.h"
+#include "profile.h"
+
+#ifdef PROFILE_ENABLE
+
+static const char *const regionNames[NUM_PROFILE_REGIONS] =
+{
+    "High priority ISR ",
+    "Low priority ISR  ",
+    "Workload iteration",
+    "Set compare value ",
+    "Sine step         ",
+};
+
+static profileEntry_t profileTable[NUM_PROFILE_REGIONS];
+// Cycles spent by the START/STOP pair itself, removed from every sample
+static uint16_t profileOverhead;
+
+static void Profile_Clear(profileEntry_t *entry)
+{
+    entry->count = 0;
+    entry->min = UINT16_MAX;
+    entry->max = 0;
+    entry->total = 0;
+}
+
+void Profile_Init(void)
+{
+    Init_Timer1();
+    // Time an empty region to find the cost of the macros themselves
+    PROFILE_START(PROFILE_REGION_ISR);
+    profileOverhead = TMR1 - profileStart_PROFILE_REGION_ISR;
+    for (uint8_t i = 0; i < NUM_PROFILE_REGIONS; i++)
+    {
+        Profile_Clear(&profileTable[i]);
+    }
+}
+
+void Profile_Record(profileRegion_e region, uint16_t cycles)
+{
+    profileEntry_t *entry = &profileTable[region];
+
+    cycles -= profileOverhead;
+    entry->count++;
+    entry->total += cycles;
+    if (cycles < entry->min)
+    {
+        entry->min = cycles;
+    }
+    if (cycles > entry->max)
+    {
+        entry->max = cycles;
+    }
+}
+
+functionResult_e Profile_Dump(unsigned int numArgs, int args[])
+{
+    profileEntry_t entry;
+
+    Console_Print("Profiled regions since the last dump (cycles at 12 MHz):");
+    Console_PrintDivider();
+    Console_Print("Region                   Count    Min    Max  Average");
+    for (uint8_t i = 0; i < NUM_PROFILE_REGIONS; i++)
+    {
+        // The ISR entry can change under us, take a consistent copy and
+        // start the next dump's numbers from here
+        INTCONbits.GIE = 0;
+        entry = profileTable[i];
+        Profile_Clear(&profileTable[i]);
+        INTCONbits.GIE = 1;
+        if (entry.count == 0)
+        {
+            Console_Print("%s           0", regionNames[i]);
+        }
+        else
+        {
+            Console_Print("%s %11lu %6u %6u %8lu", regionNames[i], entry.count, entry.min, entry.max, (uint32_t)(entry.total / entry.count));
+        }
+    }
+    Console_PrintDivider();
+
+    return SUCCESS;
+}
+
+#else
+
+functionResult_e Profile_Dump(unsigned int numArgs, int args[])
+{
+    Console_Print("Profiling is not enabled in this build, define PROFILE_ENABLE.");
+
+    return SUCCESS;
+}
+
+#endif // PROFILE_ENABLE
+
+// Always built, sampling it only costs a TMR3 read and a compare
+functionResult_e Profile_Latency(unsigned int numArgs, int args[])
+{
+    uint16_t worst;
+
+    INTCONbits.GIE = 0;
+    worst = pulseLatencyWorst;
+    pulseLatencyWorst = 0;
+    INTCONbits.GIE = 1;
+    // 2 us for every 3 ticks, shown in ns to keep the fraction
+    Console_Print("Worst pulse latency since last asked: %u ticks (%lu ns)", worst, ((uint32_t)worst * 2000) / 3);
+
+    return SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+#include "console.h"
+
+// Profiling is compiled in by adding PROFILE_ENABLE to the project's
+// preprocessor macros. Regions are timed with Timer1 running free at FOSC/4
+// (12 MHz), so one count is one instruction cycle and a single region can be
+// at most 65535 cycles (~5.4 ms) long before it wraps.
+
+typedef enum
+{
+    PROFILE_REGION_ISR = 0,
+    PROFILE_REGION_LOW_ISR,
+    PROFILE_REGION_WORKLOAD_ITERATION,
+    PROFILE_REGION_SET_COMPARE,
+    PROFILE_REGION_SINE_STEP,
+    NUM_PROFILE_REGIONS,
+} profileRegion_e;
+
+typedef struct profileEntry
+{
+    uint32_t            count;
+    uint16_t            min;
+    uint16_t            max;
+    uint64_t            total;      // The 10 us tick alone fills 32 bits in minutes
+} profileEntry_t;
+
+#ifdef PROFILE_ENABLE
+#define PROFILE_START(region)   uint16_t profileStart_##region = TMR1
+#define PROFILE_STOP(region)    Profile_Record((region), TMR1 - profileStart_##region)
+void Profile_Init(void);
+void Profile_Record(profileRegion_e region, uint16_t cycles);
+#else
+#define PROFILE_START(region)
+#define PROFILE_STOP(region)
+#define Profile_Init()
+#endif
+
+functionResult_e Profile_Dump(unsigned int numArgs, int args[]);
+functionResult_e Profile_Latency(unsigned int numArgs, int args[]);
+
+#endif // PROFILE_H
\ No newline at end of file
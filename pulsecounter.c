@@ -0,0 +1,137 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "glitch.h"
+#include "pulsecounter.h"
+
+#define COUNTER_RANGE   (65536UL)
+
+static uint16_t counterPreload;
+static volatile uint16_t overflowsRemaining;
+static volatile uint16_t overflowCount;
+static volatile bool targetReached;
+static bool stopPending;
+
+static uint16_t PulseCounter_ReadTimer(void)
+{
+    uint8_t low;
+
+    // Reading TMR0L latches TMR0H
+    low = TMR0L;
+    return ((uint16_t)TMR0H << 8) | low;
+}
+
+void PulseCounter_Arm(uint32_t target)
+{
+    // target = (overflows - 1) * 65536 + remainder, with remainder in 1-65536
+    uint32_t remainder = ((target - 1) % COUNTER_RANGE) + 1;
+
+    T0CONbits.TMR0ON = 0;
+    INTCONbits.TMR0IE = 0;
+    counterPreload = (uint16_t)(COUNTER_RANGE - remainder);
+    overflowsRemaining = (uint16_t)((target - 1) / COUNTER_RANGE);
+    overflowCount = 0;
+    targetReached = false;
+    stopPending = false;
+    // TMR0H is buffered and only written along with TMR0L
+    TMR0H = (uint8_t)(counterPreload >> 8);
+    TMR0L = (uint8_t)(counterPreload);
+    INTCONbits.TMR0IF = 0;
+    INTCONbits.TMR0IE = 1;
+    T0CONbits.TMR0ON = 1;
+    // Pulses are generated from the ECCP1 interrupt
+    PIE1bits.CCP1IE = 1;
+}
+
+void PulseCounter_Disarm(void)
+{
+    INTCONbits.TMR0IE = 0;
+    T0CONbits.TMR0ON = 0;
+    // Let the next workload pulse again
+    PIE1bits.CCP1IE = 1;
+}
+
+// Shut off the comparator and its interrupt so nothing in the main loop
+// can restart pulsing before it notices
+static void PulseCounter_StopIsr(void)
+{
+    CCP1CONbits.CCP1M = 0x0;
+    PIE1bits.CCP1IE = 0;
+    targetReached = true;
+}
+
+void PulseCounter_OverflowIsr(void)
+{
+    overflowCount++;
+    if (overflowsRemaining != 0)
+    {
+        overflowsRemaining--;
+        return;
+    }
+
+    // That was the last pulse. A glitch pattern still playing needs the
+    // comparator for the rest of its edges, it stops pulses after its last.
+    INTCONbits.TMR0IE = 0;
+    if (glitchPlaying)
+    {
+        stopPending = true;
+        return;
+    }
+    PulseCounter_StopIsr();
+}
+
+// Called once a glitch pattern has put RB0 back high
+void PulseCounter_PatternDoneIsr(void)
+{
+    if (stopPending)
+    {
+        stopPending = false;
+        PulseCounter_StopIsr();
+    }
+}
+
+bool PulseCounter_IsDone(void)
+{
+    return targetReached;
+}
+
+uint32_t PulseCounter_GetCount(void)
+{
+    uint16_t overflows;
+    uint16_t timer;
+
+    // Make sure the overflow count matches the timer value we read
+    do
+    {
+        overflows = overflowCount;
+        timer = PulseCounter_ReadTimer();
+    }
+    while (overflows != overflowCount);
+
+    return ((uint32_t)overflows * COUNTER_RANGE) + timer - counterPreload;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef PULSECOUNTER_H
+#define PULSECOUNTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Pulses are counted in hardware by Timer0, clocked from T0CKI which is
+// mapped to RB3 (RP6). RB0 has to be jumpered to RB3 for this to work.
+
+void PulseCounter_Arm(uint32_t target);
+void PulseCounter_Disarm(void);
+void PulseCounter_OverflowIsr(void);
+void PulseCounter_PatternDoneIsr(void);
+bool PulseCounter_IsDone(void);
+uint32_t PulseCounter_GetCount(void);
+
+#endif // PULSECOUNTER_H
\ No newline at end of file
@@ -0,0 +1,76 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <stdint.h>
+
+#include "console.h"
+#include "utils.h"
+#include "powerlossemu.h"
+#include "playlist.h"
+#include "capture.h"
+#include "loopback.h"
+#include "sequence.h"
+#include "sweep.h"
+#include "brownout.h"
+#include "ram.h"
+
+typedef struct ramBuffer
+{
+    const char          *name;
+    uint16_t            bytes;
+} ramBuffer_t;
+
+// The big buffers as this build sized them. Everything else is small
+// enough to leave to the compiler's memory summary.
+static const ramBuffer_t ramBuffers[] =
+{
+    {"Capture samples",     CAPTURE_MAX_SAMPLES * sizeof(uint16_t)},
+    {"Loopback ring",       LOOPBACK_RING_SIZE * sizeof(uint16_t)},
+    {"Playlist segments",   PLAYLIST_MAX_SEGMENTS * (sizeof(workloadSettings_t) + sizeof(workloadStats_t))},
+    {"Sequence upload",     SEQUENCE_MAX_PROGRAM_LENGTH},
+    {"Sweep table",         (SWEEP_TABLE_SEGMENTS + 1) * sizeof(uint16_t)},
+    {"Brownout duty table", 2 * BROWNOUT_RAMP_STEPS * sizeof(uint16_t)},
+    {"Command line",        MAX_COMMAND_LINE_LENGTH},
+    {"Command arguments",   MAX_COMMAND_ARGS * sizeof(uint32_t)},
+    {"scanf line (stack)",  SCANF_BUFFER_LENGTH},
+};
+#define NUM_RAM_BUFFERS (sizeof(ramBuffers)/sizeof(ramBuffer_t))
+
+functionResult_e Ram_PrintBudget(unsigned int numArgs, int args[])
+{
+    uint16_t total = 0;
+
+    Console_PrintDivider();
+    Console_Print(" Bytes  Buffer");
+    for (uint8_t i = 0; i < NUM_RAM_BUFFERS; i++)
+    {
+        Console_Print("%6u  %s", ramBuffers[i].bytes, ramBuffers[i].name);
+        total += ramBuffers[i].bytes;
+    }
+    Console_PrintDivider();
+    Console_Print("Menus and their strings are in program memory");
+    Console_Print("Buffers take %u of %u bytes, %u left for everything else", total, RAM_TOTAL_BYTES, RAM_TOTAL_BYTES - total);
+
+    return SUCCESS;
+}
\ No newline at end of file
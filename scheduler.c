@@ -0,0 +1,70 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "scheduler.h"
+
+static schedulerTask_t tasks[SCHEDULER_MAX_TASKS];
+
+bool Scheduler_Add(schedulerTask_t task)
+{
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        if (tasks[i] == 0)
+        {
+            tasks[i] = task;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Scheduler_Remove(schedulerTask_t task)
+{
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        if (tasks[i] == task)
+        {
+            tasks[i] = 0;
+        }
+    }
+}
+
+// Gives every task one slice
+void Scheduler_Run(void)
+{
+    schedulerTask_t task;
+
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        task = tasks[i];
+        if ((task != 0) && !task())
+        {
+            tasks[i] = 0;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,431 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <conio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+#include "utils.h"
+#include "powerlossemu.h"
+#include "sequence.h"
+
+// Helpers for writing programs in C
+#define U16(x)          ((uint8_t)((x) & 0xFF)), ((uint8_t)((x) >> 8))
+#define END()           SEQUENCE_OP_END
+#define SET_PERIOD(p)   SEQUENCE_OP_SET_PERIOD, U16(p)
+#define RAMP(t, n, ms)  SEQUENCE_OP_RAMP, U16(t), (n), U16(ms)
+#define HOLD(ms)        SEQUENCE_OP_HOLD, U16(ms)
+#define LOOP(n)         SEQUENCE_OP_LOOP, (n)
+#define NEXT()          SEQUENCE_OP_NEXT
+#define RANDOM(lo, hi)  SEQUENCE_OP_RANDOM, U16(lo), U16(hi)
+#define PULSE_N(n)      SEQUENCE_OP_PULSE_N, U16(n)
+
+typedef enum
+{
+    WAIT_NONE = 0,
+    WAIT_TIME,
+    WAIT_PULSES,
+} sequenceWait_e;
+
+typedef struct sequenceProgram
+{
+    const char          *name;
+    const uint8_t       *code;
+} sequenceProgram_t;
+
+typedef struct sequenceLoop
+{
+    uint8_t             start;
+    uint8_t             remaining;
+} sequenceLoop_t;
+
+static const uint8_t opLengths[NUM_SEQUENCE_OPS] = {1, 3, 6, 3, 2, 1, 5, 3};
+
+// The hard-coded workloads expressed as programs, using the default settings
+static const uint8_t sawtoothDownProgram[] =
+{
+    LOOP(0), SET_PERIOD(10000), HOLD(1000), RAMP(4000, 20, 1000), NEXT(), END(),
+};
+static const uint8_t sawtoothUpProgram[] =
+{
+    LOOP(0), SET_PERIOD(4000), HOLD(1000), RAMP(10000, 20, 1000), NEXT(), END(),
+};
+static const uint8_t squareProgram[] =
+{
+    LOOP(0), SET_PERIOD(10000), HOLD(1000), SET_PERIOD(4000), HOLD(1000), NEXT(), END(),
+};
+// Ramp down, hold, burst, random, repeat 50x
+static const uint8_t mixedProgram[] =
+{
+    LOOP(50),
+        SET_PERIOD(10000), RAMP(2000, 16, 500), HOLD(5000),
+        SET_PERIOD(500), PULSE_N(20),
+        LOOP(10), RANDOM(1000, 20000), HOLD(1000), NEXT(),
+    NEXT(),
+    SET_PERIOD(0), END(),
+};
+
+static const sequenceProgram_t builtInPrograms[] =
+{
+    {"Sawtooth-Down", sawtoothDownProgram},
+    {"Sawtooth-Up",   sawtoothUpProgram},
+    {"Square",        squareProgram},
+    {"Mixed x50",     mixedProgram},
+};
+#define NUM_BUILT_IN_PROGRAMS (sizeof(builtInPrograms)/sizeof(sequenceProgram_t))
+
+static uint8_t uploadedProgram[SEQUENCE_MAX_PROGRAM_LENGTH];
+static bool uploadLoaded;
+static const uint8_t *program;
+
+// Interpreter state
+static uint8_t programCounter;
+static sequenceLoop_t loopStack[SEQUENCE_MAX_LOOP_DEPTH];
+static uint8_t loopDepth;
+static uint16_t period;
+static sequenceWait_e waitType;
+static uint32_t waitStart;
+static uint32_t waitLength;
+static uint8_t rampStepsRemaining;
+static int16_t rampDelta;
+static uint16_t rampTarget;
+static uint16_t rampStepTime;
+static uint16_t randomState = 0xACE1;
+
+static uint16_t Sequence_ReadU16(const uint8_t *operand)
+{
+    return ((uint16_t)operand[1] << 8) | operand[0];
+}
+
+static uint16_t Sequence_Random(void)
+{
+    // 16-bit xorshift
+    randomState ^= randomState << 7;
+    randomState ^= randomState >> 9;
+    randomState ^= randomState << 8;
+    return randomState;
+}
+
+static void Sequence_WaitMilliseconds(uint32_t currentTime, uint16_t milliseconds)
+{
+    waitType = WAIT_TIME;
+    waitStart = currentTime;
+    waitLength = (uint32_t)milliseconds * MICROSECONDS_IN_MILLISECONDS;
+}
+
+static bool Sequence_Validate(const uint8_t *code, uint8_t length)
+{
+    uint8_t pc = 0;
+    uint8_t depth = 0;
+
+    while (pc < length)
+    {
+        if (code[pc] >= NUM_SEQUENCE_OPS)
+        {
+            return false;
+        }
+        if ((pc + opLengths[code[pc]]) > length)
+        {
+            return false;
+        }
+        switch (code[pc])
+        {
+            case SEQUENCE_OP_END:
+                return (depth == 0);
+            case SEQUENCE_OP_RAMP:
+                if (code[pc + 3] == 0)
+                {
+                    return false;
+                }
+                break;
+            case SEQUENCE_OP_RANDOM:
+                // The interpreter takes the range as maximum - minimum + 1
+                if (Sequence_ReadU16(&code[pc + 3]) < Sequence_ReadU16(&code[pc + 1]))
+                {
+                    return false;
+                }
+                break;
+            case SEQUENCE_OP_LOOP:
+                if (++depth > SEQUENCE_MAX_LOOP_DEPTH)
+                {
+                    return false;
+                }
+                break;
+            case SEQUENCE_OP_NEXT:
+                if (depth-- == 0)
+                {
+                    return false;
+                }
+                break;
+            default:
+                break;
+        }
+        pc += opLengths[code[pc]];
+    }
+
+    // Ran off the end without an END
+    return false;
+}
+
+static bool Sequence_Upload(void)
+{
+    uint16_t length = 0;
+    uint8_t nibbles = 0;
+    uint8_t value = 0;
+    char c;
+
+    // The buffer may be half written from here on
+    uploadLoaded = false;
+    Console_PrintNoEol("Enter program as hex bytes (max %d): ", SEQUENCE_MAX_PROGRAM_LENGTH);
+    // Parse straight off the wire, a line of hex would double the RAM needed
+    while ((c = getche()) != '\r')
+    {
+        if ((c >= '0') && (c <= '9'))
+        {
+            value = (value << 4) | (c - '0');
+        }
+        else if ((c >= 'a') && (c <= 'f'))
+        {
+            value = (value << 4) | (c - 'a' + 10);
+        }
+        else if ((c >= 'A') && (c <= 'F'))
+        {
+            value = (value << 4) | (c - 'A' + 10);
+        }
+        else
+        {
+            // Allow separators between bytes
+            continue;
+        }
+        if (++nibbles == 2)
+        {
+            if (length < SEQUENCE_MAX_PROGRAM_LENGTH)
+            {
+                uploadedProgram[length] = value;
+            }
+            length++;
+            nibbles = 0;
+        }
+    }
+    Console_PrintNewLine();
+
+    if (length > SEQUENCE_MAX_PROGRAM_LENGTH)
+    {
+        Console_Print(ANSI_COLOR_RED" Program too long!"ANSI_COLOR_RESET);
+        return false;
+    }
+    if (!Sequence_Validate(uploadedProgram, length))
+    {
+        Console_Print(ANSI_COLOR_RED" Invalid program!"ANSI_COLOR_RESET);
+        return false;
+    }
+    Console_Print("Loaded %d byte program", length);
+    uploadLoaded = true;
+
+    return true;
+}
+
+const char *Sequence_GetProgramName(uint8_t selection)
+{
+    if (selection == SEQUENCE_UPLOADED_PROGRAM)
+    {
+        return "Uploaded";
+    }
+    if (selection < NUM_BUILT_IN_PROGRAMS)
+    {
+        return builtInPrograms[selection].name;
+    }
+
+    return "Unknown";
+}
+
+// Uploads don't survive a reset, so a resumed run may have lost its program
+bool Sequence_IsLoaded(uint8_t selection)
+{
+    if (selection == SEQUENCE_UPLOADED_PROGRAM)
+    {
+        return uploadLoaded;
+    }
+
+    return (selection < NUM_BUILT_IN_PROGRAMS);
+}
+
+void Sequence_Start(uint8_t selection, uint32_t currentTime)
+{
+    program = (selection == SEQUENCE_UPLOADED_PROGRAM) ? uploadedProgram : builtInPrograms[selection].code;
+    programCounter = 0;
+    loopDepth = 0;
+    period = 0;
+    waitType = WAIT_NONE;
+    rampStepsRemaining = 0;
+}
+
+sequenceStatus_e Sequence_Service(uint32_t currentTime, uint16_t *newPeriod)
+{
+    const uint8_t *instruction;
+
+    // Still waiting on a HOLD, RAMP step or PULSE_N
+    if (waitType == WAIT_TIME)
+    {
+        if ((currentTime - waitStart) < waitLength)
+        {
+            return SEQUENCE_RUNNING;
+        }
+    }
+    else if (waitType == WAIT_PULSES)
+    {
+        if ((Util_GetPulseCount() - waitStart) < waitLength)
+        {
+            return SEQUENCE_RUNNING;
+        }
+    }
+    waitType = WAIT_NONE;
+
+    // Carry on with a ramp in progress
+    if (rampStepsRemaining != 0)
+    {
+        rampStepsRemaining--;
+        period = (rampStepsRemaining == 0) ? rampTarget : (period + rampDelta);
+        Sequence_WaitMilliseconds(currentTime, rampStepTime);
+        *newPeriod = period;
+        return SEQUENCE_PERIOD_CHANGED;
+    }
+
+    // Decode exactly one instruction per call
+    instruction = &program[programCounter];
+    programCounter += opLengths[instruction[0]];
+    switch (instruction[0])
+    {
+        case SEQUENCE_OP_SET_PERIOD:
+            period = Sequence_ReadU16(&instruction[1]);
+            *newPeriod = period;
+            return SEQUENCE_PERIOD_CHANGED;
+        case SEQUENCE_OP_RAMP:
+            rampTarget = Sequence_ReadU16(&instruction[1]);
+            rampStepsRemaining = instruction[3];
+            rampStepTime = Sequence_ReadU16(&instruction[4]);
+            rampDelta = (int16_t)(((int32_t)rampTarget - (int32_t)period) / rampStepsRemaining);
+            break;
+        case SEQUENCE_OP_HOLD:
+            Sequence_WaitMilliseconds(currentTime, Sequence_ReadU16(&instruction[1]));
+            break;
+        case SEQUENCE_OP_LOOP:
+            loopStack[loopDepth].start = programCounter;
+            loopStack[loopDepth].remaining = instruction[1];
+            loopDepth++;
+            break;
+        case SEQUENCE_OP_NEXT:
+        {
+            sequenceLoop_t *loop = &loopStack[loopDepth - 1];
+            // A count of zero loops forever
+            if ((loop->remaining == 0) || (--loop->remaining != 0))
+            {
+                programCounter = loop->start;
+            }
+            else
+            {
+                loopDepth--;
+            }
+            break;
+        }
+        case SEQUENCE_OP_RANDOM:
+        {
+            uint16_t minimum = Sequence_ReadU16(&instruction[1]);
+            uint32_t range = (uint32_t)Sequence_ReadU16(&instruction[3]) - minimum + 1;
+            period = minimum + (uint16_t)(Sequence_Random() % range);
+            *newPeriod = period;
+            return SEQUENCE_PERIOD_CHANGED;
+        }
+        case SEQUENCE_OP_PULSE_N:
+            waitType = WAIT_PULSES;
+            waitStart = Util_GetPulseCount();
+            waitLength = Sequence_ReadU16(&instruction[1]);
+            break;
+        case SEQUENCE_OP_END:
+        default:
+            programCounter -= opLengths[SEQUENCE_OP_END];
+            return SEQUENCE_DONE;
+    }
+
+    return SEQUENCE_RUNNING;
+}
+
+uint16_t Sequence_GetProgramCounter(void)
+{
+    return programCounter;
+}
+
+functionResult_e Sequence_Select(unsigned int numArgs, int args[])
+{
+    unsigned int selection;
+    uint8_t programSelection;
+
+    // A program segment may be interpreting the one that would be replaced,
+    // and uploads are only safe to run once they've been validated
+    if (PowerLossEmu_IsRunning())
+    {
+        Console_Print(ANSI_COLOR_RED" Stop the running workload first!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+
+    Console_Print("Current program: %s", Sequence_GetProgramName(PowerLossEmu_GetProgram()));
+    Console_PrintDivider();
+    for (uint8_t i = 0; i < NUM_BUILT_IN_PROGRAMS; i++)
+    {
+        Console_Print("[%d]-%s", i, builtInPrograms[i].name);
+    }
+    Console_Print("[%d]-Upload from host", NUM_BUILT_IN_PROGRAMS);
+    Console_PrintDivider();
+    // Arguments: program
+    selection = Console_ArgOrPromptForInt(numArgs, args, 0, "Enter program: ");
+
+    if (selection < NUM_BUILT_IN_PROGRAMS)
+    {
+        programSelection = (uint8_t)selection;
+    }
+    else if (selection == NUM_BUILT_IN_PROGRAMS)
+    {
+        if (!Sequence_Upload())
+        {
+            // The buffer may be half written, don't leave it selected
+            if (PowerLossEmu_GetProgram() == SEQUENCE_UPLOADED_PROGRAM)
+            {
+                PowerLossEmu_SetProgram(0);
+            }
+            return ERROR;
+        }
+        programSelection = SEQUENCE_UPLOADED_PROGRAM;
+    }
+    else
+    {
+        Console_Print(ANSI_COLOR_RED" Bad selection!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+    PowerLossEmu_SetProgram(programSelection);
+    Console_Print("Selected program: %s (run with the program workload type)", Sequence_GetProgramName(programSelection));
+
+    return SUCCESS;
+}
\ No newline at end of file
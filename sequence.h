@@ -0,0 +1,88 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef SEQUENCE_H
+#define SEQUENCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+
+// Workload sequences are a compact bytecode assembled on the host. Every
+// instruction is an opcode byte followed by a fixed number of operand bytes
+// (see below), 16-bit operands are little-endian. Programs are validated
+// once when loaded so the interpreter can decode one instruction per call
+// without any bounds checking.
+//
+//  Opcode                  Operands                                Length
+//  0x00 END                -                                       1
+//  0x01 SET_PERIOD         period (us, u16, 0 = pulses off)        3
+//  0x02 RAMP               target (us, u16), steps (u8),
+//                          step time (ms, u16)                     6
+//  0x03 HOLD               time (ms, u16)                          3
+//  0x04 LOOP               count (u8, 0 = forever)                 2
+//  0x05 NEXT               -                                       1
+//  0x06 RANDOM             minimum (us, u16), maximum (us, u16,    5
+//                          not below minimum)
+//  0x07 PULSE_N            pulses (u16)                            3
+//
+// LOOP/NEXT pairs repeat the instructions between them and can be nested up
+// to SEQUENCE_MAX_LOOP_DEPTH deep.
+
+#define SEQUENCE_MAX_PROGRAM_LENGTH (64)
+#define SEQUENCE_MAX_LOOP_DEPTH     (4)
+// Program selections are the built-in index or this for the one uploaded.
+// Only the selection is kept with the settings, a new upload replaces what
+// every segment selecting it runs.
+#define SEQUENCE_UPLOADED_PROGRAM   (0xFF)
+
+typedef enum
+{
+    SEQUENCE_OP_END = 0x00,
+    SEQUENCE_OP_SET_PERIOD = 0x01,
+    SEQUENCE_OP_RAMP = 0x02,
+    SEQUENCE_OP_HOLD = 0x03,
+    SEQUENCE_OP_LOOP = 0x04,
+    SEQUENCE_OP_NEXT = 0x05,
+    SEQUENCE_OP_RANDOM = 0x06,
+    SEQUENCE_OP_PULSE_N = 0x07,
+    NUM_SEQUENCE_OPS,
+} sequenceOp_e;
+
+typedef enum
+{
+    SEQUENCE_RUNNING = 0,
+    SEQUENCE_PERIOD_CHANGED,
+    SEQUENCE_DONE,
+} sequenceStatus_e;
+
+const char *Sequence_GetProgramName(uint8_t selection);
+bool Sequence_IsLoaded(uint8_t selection);
+void Sequence_Start(uint8_t selection, uint32_t currentTime);
+sequenceStatus_e Sequence_Service(uint32_t currentTime, uint16_t *period);
+uint16_t Sequence_GetProgramCounter(void);
+functionResult_e Sequence_Select(unsigned int numArgs, int args[]);
+
+#endif // SEQUENCE_H
\ No newline at end of file
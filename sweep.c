@@ -0,0 +1,142 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <math.h>
+
+#include "sweep.h"
+
+static uint16_t sweepTable[SWEEP_TABLE_SEGMENTS + 1];
+// Table position per step in 16.16 fixed point
+static uint32_t positionIncrement;
+static uint16_t sweepSteps;
+
+static void Sweep_BuildChirp(uint16_t startPeriod, uint16_t endPeriod)
+{
+    // f(x) = fs + (fe - fs)x, which works out to
+    // P(x) = (Ps * Pe) / (Pe + (Ps - Pe)x)
+    // With x = i/32, scale the denominator up by 32 and split the division
+    // into quotient and remainder so nothing overflows 32 bits
+    uint32_t numerator = (uint32_t)startPeriod * endPeriod;
+    uint32_t denominator;
+    uint32_t quotient;
+    uint32_t remainder;
+
+    for (uint8_t i = 0; i <= SWEEP_TABLE_SEGMENTS; i++)
+    {
+        denominator = ((uint32_t)endPeriod * (SWEEP_TABLE_SEGMENTS - i)) + ((uint32_t)startPeriod * i);
+        quotient = numerator / denominator;
+        remainder = numerator % denominator;
+        sweepTable[i] = (uint16_t)((quotient * SWEEP_TABLE_SEGMENTS) + ((remainder * SWEEP_TABLE_SEGMENTS) / denominator));
+    }
+}
+
+static void Sweep_BuildExp(uint16_t startPeriod, uint16_t endPeriod)
+{
+    // P(x) = Ps * (Pe / Ps)^x, one ratio between each pair of points
+    float ratio = powf((float)endPeriod / (float)startPeriod, 1.0 / SWEEP_TABLE_SEGMENTS);
+    float period = startPeriod;
+
+    for (uint8_t i = 0; i < SWEEP_TABLE_SEGMENTS; i++)
+    {
+        sweepTable[i] = (uint16_t)(period + 0.5);
+        period *= ratio;
+    }
+    // Land on the end exactly whatever rounding piled up
+    sweepTable[SWEEP_TABLE_SEGMENTS] = endPeriod;
+}
+
+static void Sweep_BuildLog(uint16_t startPeriod, uint16_t endPeriod)
+{
+    // P(x) = Ps + (Pe - Ps) * log2(1 + 15x) / 4, covers three quarters of
+    // the distance in the first fifth of the sweep
+    float span = (float)endPeriod - (float)startPeriod;
+    float x;
+
+    for (uint8_t i = 0; i <= SWEEP_TABLE_SEGMENTS; i++)
+    {
+        x = (float)i / SWEEP_TABLE_SEGMENTS;
+        sweepTable[i] = (uint16_t)(startPeriod + (span * log2f(1.0 + (15.0 * x)) / 4.0) + 0.5);
+    }
+}
+
+void Sweep_Start(uint16_t startPeriod, uint16_t endPeriod, uint16_t steps, sweepLaw_e law)
+{
+    // A zero period would make the chirp divide by zero
+    if (startPeriod == 0)
+    {
+        startPeriod = 1;
+    }
+    if (endPeriod == 0)
+    {
+        endPeriod = 1;
+    }
+
+    switch (law)
+    {
+        case SWEEP_LAW_CHIRP:
+            Sweep_BuildChirp(startPeriod, endPeriod);
+            break;
+        case SWEEP_LAW_LOG:
+            Sweep_BuildLog(startPeriod, endPeriod);
+            break;
+        case SWEEP_LAW_EXP:
+        default:
+            Sweep_BuildExp(startPeriod, endPeriod);
+            break;
+    }
+
+    // Step 0 is the start period and step (steps - 1) is the end period
+    sweepSteps = steps;
+    if (steps < 2)
+    {
+        positionIncrement = 0;
+    }
+    else
+    {
+        // Rounded up so the last step reaches the end of the table
+        positionIncrement = (((uint32_t)SWEEP_TABLE_SEGMENTS << 16) + (steps - 2)) / (steps - 1);
+    }
+}
+
+uint16_t Sweep_GetPeriod(uint16_t step)
+{
+    uint32_t position;
+    uint8_t index;
+    uint8_t fraction;
+
+    if (sweepSteps != 0)
+    {
+        step %= sweepSteps;
+    }
+    position = step * positionIncrement;
+    index = (uint8_t)(position >> 16);
+    if (index >= SWEEP_TABLE_SEGMENTS)
+    {
+        return sweepTable[SWEEP_TABLE_SEGMENTS];
+    }
+    fraction = (uint8_t)(position >> 8);
+
+    return (uint16_t)((((uint32_t)sweepTable[index] * (256 - fraction)) + ((uint32_t)sweepTable[index + 1] * fraction)) >> 8);
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdint.h>
+
+// Period sweeps that aren't linear in period. The curve is worked out once
+// per segment into a table of SWEEP_TABLE_SEGMENTS + 1 points and each
+// step just interpolates between two of them.
+#define SWEEP_TABLE_SEGMENTS    (32)
+
+typedef enum
+{
+    SWEEP_LAW_CHIRP = 0,    // Linear in frequency
+    SWEEP_LAW_LOG,          // Quick away from the start period, slow into the end
+    SWEEP_LAW_EXP,          // Constant ratio per step, same time in every octave
+    NUM_SWEEP_LAWS,
+} sweepLaw_e;
+
+void Sweep_Start(uint16_t startPeriod, uint16_t endPeriod, uint16_t steps, sweepLaw_e law);
+uint16_t Sweep_GetPeriod(uint16_t step);
+
+#endif // SWEEP_H
\ No newline at end of file
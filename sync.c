@@ -0,0 +1,396 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+#include "utils.h"
+#include "calibration.h"
+#include "syncloop.h"
+#include "sync.h"
+
+#define SYNC_MESSAGE_NONE           (0x00)
+#define SYNC_MESSAGE_LENGTH         (3)     // Header, type, inverted type
+#define SYNC_SETTLE_EDGES           (4)     // Edges left out of the skew report
+
+volatile bool syncActive;
+
+static syncSettings_t syncSettings;
+static const char *const roleNames[NUM_SYNC_ROLES] = {"off", "leader", "follower"};
+
+// Leader
+static uint8_t edgePulses;
+static bool lineLow;
+
+// Follower
+static syncLoop_t syncLoop;
+static uint16_t periodTicks;
+static uint16_t startTimerValue;
+static uint16_t loopStaggerTicks;
+static volatile bool waitingForEdge;
+static volatile bool edgeCaptured;
+static volatile uint16_t edgeTimerValue;
+static volatile bool correctionPending;
+static volatile int16_t pendingCorrection;
+
+// Follower skew report, all in Timer3 ticks
+static uint16_t edgesSeen;
+static int16_t lastSkew;
+static uint16_t worstSkew;
+static uint32_t skewMagnitudeSum;
+
+// Control message parser
+static uint8_t messageIndex;
+static uint8_t messageType;
+
+static uint32_t Sync_MicrosecondsToTicks(uint32_t microseconds)
+{
+    // 2 us for every 3 ticks
+    return (microseconds * 3) / 2;
+}
+
+static int16_t Sync_TicksToMicroseconds(int32_t ticks)
+{
+    return (int16_t)((ticks * 2) / 3);
+}
+
+static void Sync_SendMessage(uint8_t type)
+{
+    uint8_t message[SYNC_MESSAGE_LENGTH] = {SYNC_MESSAGE_HEADER, type, (uint8_t)~type};
+
+    for (uint8_t i = 0; i < SYNC_MESSAGE_LENGTH; i++)
+    {
+        while (!PIR3bits.TX2IF);
+        TXREG2 = message[i];
+    }
+    // Wait for the last stop bit so everything after this is timed from it
+    while (!TXSTA2bits.TRMT);
+}
+
+static uint8_t Sync_ReadMessage(void)
+{
+    uint8_t c;
+
+    // An overrun stops the receiver until it's reset
+    if (RCSTA2bits.OERR)
+    {
+        RCSTA2bits.CREN = 0;
+        RCSTA2bits.CREN = 1;
+    }
+    while (PIR3bits.RC2IF)
+    {
+        c = RCREG2;
+        switch (messageIndex)
+        {
+            case 0:
+                if (c == SYNC_MESSAGE_HEADER)
+                {
+                    messageIndex = 1;
+                }
+                break;
+            case 1:
+                messageType = c;
+                messageIndex = 2;
+                break;
+            default:
+                messageIndex = 0;
+                if (c == (uint8_t)~messageType)
+                {
+                    return messageType;
+                }
+                break;
+        }
+    }
+
+    return SYNC_MESSAGE_NONE;
+}
+
+bool Sync_WaitForStart(void)
+{
+    if (syncSettings.role != SYNC_ROLE_FOLLOWER)
+    {
+        return true;
+    }
+
+    Console_Print("Board %d waiting for the leader, press any key to cancel...", syncSettings.boardId);
+    messageIndex = 0;
+    for (;;)
+    {
+        if (Sync_ReadMessage() == SYNC_MESSAGE_START)
+        {
+            return true;
+        }
+        if (Console_CheckForKey() != 0)
+        {
+            return false;
+        }
+    }
+}
+
+bool Sync_IsEnabled(void)
+{
+    return (syncSettings.role != SYNC_ROLE_OFF);
+}
+
+void Sync_StartCompare(uint16_t period)
+{
+    uint32_t startTime;
+    uint16_t staggerTicks;
+
+    edgePulses = 0;
+    edgesSeen = 0;
+    lastSkew = 0;
+    worstSkew = 0;
+    skewMagnitudeSum = 0;
+    if ((syncSettings.role == SYNC_ROLE_OFF) || (period == 0))
+    {
+        syncActive = false;
+        Util_SetNewCompareValue(period);
+        return;
+    }
+    syncActive = true;
+
+    if (syncSettings.role == SYNC_ROLE_LEADER)
+    {
+        Sync_SendMessage(SYNC_MESSAGE_START);
+        Util_WaitMicrosecond(SYNC_START_MARGIN_US);
+        // The start edge and the first period begin together, the line is
+        // let go again on the first match
+        INTCONbits.GIE = 0;
+        LATBbits.LATB1 = 0;
+        Util_SetNewCompareValue(period);
+        lineLow = true;
+        INTCONbits.GIE = 1;
+        return;
+    }
+
+    // Followers leave it to the edge interrupt to start the comparator
+    Util_SetNewCompareValue(0);
+    periodTicks = Calibration_PeriodToTicks(period);
+    staggerTicks = (uint16_t)(Sync_MicrosecondsToTicks((uint32_t)syncSettings.staggerMicroseconds * syncSettings.boardId) % periodTicks);
+    startTimerValue = SyncLoop_StartTimerValue(staggerTicks);
+    loopStaggerTicks = SyncLoop_EdgeStaggerTicks(staggerTicks, periodTicks);
+    SyncLoop_Reset(&syncLoop);
+    correctionPending = false;
+    edgeCaptured = false;
+    waitingForEdge = true;
+    INTCON3bits.INT1IF = 0;
+    INTCON3bits.INT1IE = 1;
+
+    startTime = Util_GetMicrosecondUptime();
+    while (waitingForEdge)
+    {
+        if ((Util_GetMicrosecondUptime() - startTime) > SYNC_START_TIMEOUT_US)
+        {
+            INTCONbits.GIE = 0;
+            if (waitingForEdge)
+            {
+                // Go on our own, the first periodic edge pulls us in
+                waitingForEdge = false;
+                Util_SetNewCompareValue(period);
+                Console_Print(ANSI_COLOR_YELLOW" No start edge from the leader, starting unaligned"ANSI_COLOR_RESET);
+            }
+            INTCONbits.GIE = 1;
+        }
+    }
+}
+
+bool Sync_Service(void)
+{
+    int16_t correction;
+    uint16_t timerValue;
+    uint16_t skewMagnitude;
+
+    if (!syncActive || (syncSettings.role != SYNC_ROLE_FOLLOWER))
+    {
+        return true;
+    }
+
+    if (Sync_ReadMessage() == SYNC_MESSAGE_STOP)
+    {
+        return false;
+    }
+
+    if (edgeCaptured)
+    {
+        INTCON3bits.INT1IE = 0;
+        timerValue = edgeTimerValue;
+        edgeCaptured = false;
+        INTCON3bits.INT1IE = 1;
+
+        correction = SyncLoop_Update(&syncLoop, timerValue, periodTicks, loopStaggerTicks);
+        // The last one is always long gone by the next edge
+        if (!correctionPending)
+        {
+            pendingCorrection = correction;
+            correctionPending = true;
+        }
+
+        edgesSeen++;
+        lastSkew = syncLoop.error;
+        if (edgesSeen > SYNC_SETTLE_EDGES)
+        {
+            skewMagnitude = (lastSkew < 0) ? (uint16_t)(-lastSkew) : (uint16_t)lastSkew;
+            skewMagnitudeSum += skewMagnitude;
+            if (skewMagnitude > worstSkew)
+            {
+                worstSkew = skewMagnitude;
+            }
+        }
+    }
+
+    return true;
+}
+
+void Sync_Stop(void)
+{
+    if (!syncActive)
+    {
+        return;
+    }
+    syncActive = false;
+
+    if (syncSettings.role == SYNC_ROLE_LEADER)
+    {
+        LATBbits.LATB1 = 1;
+        Sync_SendMessage(SYNC_MESSAGE_STOP);
+    }
+    else
+    {
+        INTCON3bits.INT1IE = 0;
+        waitingForEdge = false;
+    }
+}
+
+void Sync_CompareIsr(void)
+{
+    if (syncSettings.role == SYNC_ROLE_LEADER)
+    {
+        if (lineLow)
+        {
+            LATBbits.LATB1 = 1;
+            lineLow = false;
+        }
+        if (++edgePulses >= SYNC_EDGE_INTERVAL)
+        {
+            edgePulses = 0;
+            LATBbits.LATB1 = 0;
+            lineLow = true;
+        }
+    }
+    else if (correctionPending)
+    {
+        // TMR3 was just cleared by the special event. Winding it back makes
+        // this period longer (it wraps through zero on the way to CCPR1),
+        // winding it forward makes it shorter.
+        TMR3 -= pendingCorrection;
+        correctionPending = false;
+    }
+}
+
+void Sync_EdgeIsr(void)
+{
+    uint16_t timerValue = TMR3;
+
+    if (waitingForEdge)
+    {
+        CCP1CONbits.CCP1M = 0x0;    // 0b0000 = Capture/Compare/PWM off (resets ECCPx module)
+        CCPR1 = periodTicks;
+        TMR3 = startTimerValue;
+        CCP1CONbits.CCP1M = 0xB;    // 0b1011 = Compare mode, trigger special event
+        waitingForEdge = false;
+        return;
+    }
+    edgeTimerValue = timerValue;
+    edgeCaptured = true;
+}
+
+void Sync_PrintStats(void)
+{
+    uint16_t settledEdges;
+
+    if (syncSettings.role != SYNC_ROLE_FOLLOWER)
+    {
+        return;
+    }
+
+    Console_Print("Sync edges:      %10u", edgesSeen);
+    if (edgesSeen == 0)
+    {
+        Console_Print(ANSI_COLOR_RED" No sync edges seen, is RB1 wired to the leader?"ANSI_COLOR_RESET);
+        return;
+    }
+    Console_Print("Last skew:       %10d us", Sync_TicksToMicroseconds(lastSkew));
+    if (edgesSeen > SYNC_SETTLE_EDGES)
+    {
+        settledEdges = edgesSeen - SYNC_SETTLE_EDGES;
+        Console_Print("Mean |skew|:     %10d us", Sync_TicksToMicroseconds(skewMagnitudeSum / settledEdges));
+        Console_Print("Worst |skew|:    %10d us", Sync_TicksToMicroseconds(worstSkew));
+    }
+}
+
+// Last measured skew in us, zero unless following
+int16_t Sync_GetSkew(void)
+{
+    return Sync_TicksToMicroseconds(lastSkew);
+}
+
+functionResult_e Sync_Setup(unsigned int numArgs, int args[])
+{
+    unsigned int role;
+    unsigned int boardId;
+
+    Console_Print("Sync is currently %s, board id %d, %u us stagger per id", roleNames[syncSettings.role], syncSettings.boardId, syncSettings.staggerMicroseconds);
+    // Arguments: role [id stagger]
+    role = Console_ArgOrPromptForInt(numArgs, args, 0, "Enter role (0 = off, 1 = leader, 2 = follower): ");
+    if (role >= NUM_SYNC_ROLES)
+    {
+        Console_Print(ANSI_COLOR_RED"Invalid role!"ANSI_COLOR_RESET);
+        return ERROR;
+    }
+    if (role == SYNC_ROLE_FOLLOWER)
+    {
+        boardId = Console_ArgOrPromptForInt(numArgs, args, 1, "Enter board id (0-255): ");
+        if (boardId > UINT8_MAX)
+        {
+            Console_Print(ANSI_COLOR_RED"Invalid board id!"ANSI_COLOR_RESET);
+            return ERROR;
+        }
+        syncSettings.boardId = (uint8_t)boardId;
+        syncSettings.staggerMicroseconds = Console_ArgOrPromptForInt(numArgs, args, 2, "Enter stagger per board id (us): ");
+    }
+    else
+    {
+        syncSettings.boardId = 0;
+    }
+    syncSettings.role = (uint8_t)role;
+
+    // Only the leader drives the sync line
+    TRISBbits.TRISB1 = (role == SYNC_ROLE_LEADER) ? 0 : 1;
+    Console_Print("Board is a sync %s", roleNames[syncSettings.role]);
+
+    return SUCCESS;
+}
\ No newline at end of file
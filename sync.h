@@ -0,0 +1,77 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+
+// Boards in a rack share a sync line on RB1 (leader drives it, followers
+// take it in on INT1 through RP4) and a control link on EUSART2 (TX2 on RB4,
+// RX2 on RB5). The leader pulls the line low to start a run and again every
+// SYNC_EDGE_INTERVAL pulses. Followers sample TMR3 on each edge and nudge
+// their own Timer3 so their compare match lands stagger x board id after
+// the leader's. Everyone needs to be running the same period for this to
+// mean anything, and it can't change during the run, so synced runs are
+// refused unless every segment holds one fixed period.
+
+#define SYNC_EDGE_INTERVAL          (64)    // Leader pulses between sync edges
+#define SYNC_MESSAGE_HEADER         (0xC3)
+#define SYNC_MESSAGE_START          (0x01)
+#define SYNC_MESSAGE_STOP           (0x02)
+#define SYNC_START_MARGIN_US        (1000)  // Time for followers to arm after START
+#define SYNC_START_TIMEOUT_US       (100000)
+
+typedef enum
+{
+    SYNC_ROLE_OFF = 0,
+    SYNC_ROLE_LEADER,
+    SYNC_ROLE_FOLLOWER,
+    NUM_SYNC_ROLES
+} syncRole_e;
+
+typedef struct syncSettings
+{
+    uint8_t             role;
+    uint8_t             boardId;
+    uint16_t            staggerMicroseconds;    // Per board id
+} syncSettings_t;
+
+extern volatile bool syncActive;
+
+bool Sync_WaitForStart(void);
+bool Sync_IsEnabled(void);
+void Sync_StartCompare(uint16_t period);
+bool Sync_Service(void);
+void Sync_Stop(void);
+void Sync_CompareIsr(void);
+void Sync_EdgeIsr(void);
+void Sync_PrintStats(void);
+int16_t Sync_GetSkew(void);
+functionResult_e Sync_Setup(unsigned int numArgs, int args[]);
+
+#endif // SYNC_H
\ No newline at end of file
@@ -0,0 +1,93 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <stdint.h>
+
+#include "syncloop.h"
+
+void SyncLoop_Reset(syncLoop_t *loop)
+{
+    loop->integral = 0;
+    loop->error = 0;
+    loop->acquired = false;
+}
+
+// What to load TMR3 with on the start edge. It is wound back by our stagger,
+// and forward by the time it takes to get into the interrupt.
+uint16_t SyncLoop_StartTimerValue(uint16_t staggerTicks)
+{
+    return (uint16_t)(SYNC_ISR_LATENCY_TICKS - staggerTicks);
+}
+
+// The stagger to hand SyncLoop_Update. Periodic edges come from the leader's
+// interrupt and are read in ours, so TMR3 reads both latencies late.
+uint16_t SyncLoop_EdgeStaggerTicks(uint16_t staggerTicks, uint16_t periodTicks)
+{
+    return (uint16_t)(((uint32_t)staggerTicks + (2 * (uint32_t)periodTicks) - (2 * SYNC_ISR_LATENCY_TICKS)) % periodTicks);
+}
+
+// ticksSinceMatch is TMR3 sampled at the leader's sync edge, which is the
+// time since our own last compare match. We want our match to land
+// staggerTicks after the leader's, so at the edge TMR3 should read
+// (periodTicks - staggerTicks). Returns the number of ticks to add to one
+// upcoming period to pull us back into line.
+int16_t SyncLoop_Update(syncLoop_t *loop, uint16_t ticksSinceMatch, uint16_t periodTicks, uint16_t staggerTicks)
+{
+    int32_t error = ((uint32_t)ticksSinceMatch + staggerTicks) % periodTicks;
+    int32_t correction;
+
+    // Wrap into (-period/2, period/2], positive means we matched early
+    if (error > (int32_t)(periodTicks / 2))
+    {
+        error -= periodTicks;
+    }
+    loop->error = (int16_t)error;
+
+    // Proportional term removes the phase error in one go, the integral
+    // learns the clock drift so it gets removed before we measure it. The
+    // first error is just where we happened to start, not drift.
+    if (loop->acquired)
+    {
+        loop->integral += error >> SYNC_LOOP_KI_SHIFT;
+    }
+    loop->acquired = true;
+    correction = error + loop->integral;
+
+    // Never shorten a period by more than half of it
+    if (correction < -(int32_t)(periodTicks / 2))
+    {
+        correction = -(int32_t)(periodTicks / 2);
+    }
+    // Winding TMR3 back has to leave it past CCPR1 or it matches early
+    if (correction > ((int32_t)UINT16_MAX - periodTicks))
+    {
+        correction = (int32_t)UINT16_MAX - periodTicks;
+    }
+    if (correction > INT16_MAX)
+    {
+        correction = INT16_MAX;
+    }
+
+    return (int16_t)correction;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef SYNCLOOP_H
+#define SYNCLOOP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Phase discipline for followers, kept free of any hardware access so the
+// host simulator in tools/syncsim can run the exact same code.
+
+// Integral gain is 1/2^SYNC_LOOP_KI_SHIFT
+#define SYNC_LOOP_KI_SHIFT      (1)
+// Interrupt entry up to the first line of each branch, in Timer3 ticks. The
+// leader's edge is late by one of these and the follower reads TMR3 late by
+// another. Trim against a scope on both boards' RB0.
+#define SYNC_ISR_LATENCY_TICKS  (4)
+
+typedef struct syncLoop
+{
+    int32_t             integral;   // Estimated drift per sync interval (ticks)
+    int16_t             error;      // Last measured phase error (ticks)
+    bool                acquired;   // First edge seen, phase is roughly right
+} syncLoop_t;
+
+void SyncLoop_Reset(syncLoop_t *loop);
+uint16_t SyncLoop_StartTimerValue(uint16_t staggerTicks);
+uint16_t SyncLoop_EdgeStaggerTicks(uint16_t staggerTicks, uint16_t periodTicks);
+int16_t SyncLoop_Update(syncLoop_t *loop, uint16_t ticksSinceMatch, uint16_t periodTicks, uint16_t staggerTicks);
+
+#endif // SYNCLOOP_H
\ No newline at end of file
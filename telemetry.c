@@ -0,0 +1,142 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include <xc.h>
+#include <conio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+#include "utils.h"
+#include "telemetry.h"
+
+static bool telemetryEnabled;
+static uint16_t telemetryRateHz = TELEMETRY_DEFAULT_RATE_HZ;
+static uint32_t frameInterval;
+static uint32_t nextFrameTime;
+static uint16_t sequence;
+static uint16_t droppedFrames;
+
+// Frame currently being shifted out, one byte at a time
+static telemetryFrame_t frame;
+static uint8_t bytesRemaining;
+static uint8_t *framePointer;
+
+static void Telemetry_BuildFrame(uint32_t currentTime, uint16_t period, uint16_t step)
+{
+    uint8_t *byte = (uint8_t *)&frame;
+    uint8_t sum = 0;
+
+    frame.sync[0] = TELEMETRY_SYNC_BYTE_0;
+    frame.sync[1] = TELEMETRY_SYNC_BYTE_1;
+    frame.type = TELEMETRY_FRAME_TYPE_STATUS;
+    frame.sequence = sequence++;
+    frame.timestamp = currentTime;
+    frame.period = period;
+    frame.step = step;
+    frame.pulseCount = Util_GetPulseCount();
+    frame.droppedFrames = droppedFrames;
+    for (uint8_t i = 0; i < (sizeof(telemetryFrame_t) - 1); i++)
+    {
+        sum += byte[i];
+    }
+    frame.checksum = (uint8_t)(-sum);
+
+    framePointer = (uint8_t *)&frame;
+    bytesRemaining = sizeof(telemetryFrame_t);
+}
+
+bool Telemetry_IsEnabled(void)
+{
+    return telemetryEnabled;
+}
+
+void Telemetry_Start(uint32_t currentTime)
+{
+    frameInterval = MICROSECONDS_IN_SECONDS / telemetryRateHz;
+    nextFrameTime = currentTime;
+    sequence = 0;
+    droppedFrames = 0;
+    bytesRemaining = 0;
+}
+
+void Telemetry_Service(uint32_t currentTime, uint16_t period, uint16_t step)
+{
+    // Only ever load the transmit register when it's empty, never wait on it
+    while ((bytesRemaining != 0) && TXIF)
+    {
+        TXREG1 = *framePointer++;
+        bytesRemaining--;
+    }
+
+    if ((int32_t)(currentTime - nextFrameTime) >= 0)
+    {
+        nextFrameTime += frameInterval;
+        if (bytesRemaining != 0)
+        {
+            // Link is still busy with the last frame, skip this one
+            droppedFrames++;
+        }
+        else
+        {
+            Telemetry_BuildFrame(currentTime, period, step);
+        }
+    }
+}
+
+void Telemetry_Stop(void)
+{
+    // Pulses are off by now, so it's safe to block until the frame is out
+    while (bytesRemaining != 0)
+    {
+        putch(*framePointer++);
+        bytesRemaining--;
+    }
+}
+
+functionResult_e Telemetry_Setup(unsigned int numArgs, int args[])
+{
+    uint16_t rate;
+
+    Console_Print("Telemetry is currently %s at %d Hz", telemetryEnabled ? "on" : "off", telemetryRateHz);
+    // Arguments: enable [rate]
+    telemetryEnabled = (Console_ArgOrPromptForInt(numArgs, args, 0, "Enable telemetry (0/1): ") != 0);
+    if (telemetryEnabled)
+    {
+        rate = Console_ArgOrPromptForInt(numArgs, args, 1, "Enter frame rate (Hz): ");
+        if (rate == 0)
+        {
+            rate = TELEMETRY_DEFAULT_RATE_HZ;
+        }
+        else if (rate > TELEMETRY_MAX_RATE_HZ)
+        {
+            Console_Print("Limiting rate to %d Hz for link bandwidth", TELEMETRY_MAX_RATE_HZ);
+            rate = TELEMETRY_MAX_RATE_HZ;
+        }
+        telemetryRateHz = rate;
+        Console_Print("Workloads will stream %d byte frames at %d Hz", sizeof(telemetryFrame_t), telemetryRateHz);
+    }
+
+    return SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+
+#define TELEMETRY_SYNC_BYTE_0       (0xA5)
+#define TELEMETRY_SYNC_BYTE_1       (0x5A)
+#define TELEMETRY_FRAME_TYPE_STATUS (0x01)
+#define TELEMETRY_FRAME_TYPE_CAPTURE (0x02) // See captureHeader_t
+// 115200 baud with 8N1 framing is 10 bits per byte on the wire
+#define TELEMETRY_LINK_BYTES_PER_SECOND (11520)
+// Only allow frames to use half of the link so the host never falls behind
+#define TELEMETRY_MAX_RATE_HZ       ((TELEMETRY_LINK_BYTES_PER_SECOND / 2) / sizeof(telemetryFrame_t))
+#define TELEMETRY_DEFAULT_RATE_HZ   (10)
+
+// Frames are sent little-endian exactly as laid out here (XC8 does not pad
+// structures). The checksum is the two's complement of the sum of every
+// preceding byte so the sum of a whole frame is zero.
+typedef struct telemetryFrame
+{
+    uint8_t             sync[2];
+    uint8_t             type;
+    uint16_t            sequence;
+    uint32_t            timestamp;
+    uint16_t            period;
+    uint16_t            step;
+    uint32_t            pulseCount;
+    uint16_t            droppedFrames;
+    uint8_t             checksum;
+} telemetryFrame_t;
+
+bool Telemetry_IsEnabled(void);
+void Telemetry_Start(uint32_t currentTime);
+void Telemetry_Service(uint32_t currentTime, uint16_t period, uint16_t step);
+void Telemetry_Stop(void);
+functionResult_e Telemetry_Setup(unsigned int numArgs, int args[]);
+
+#endif // TELEMETRY_H
\ No newline at end of file
@@ -0,0 +1,898 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+// Host analysis of a captured emulator serial log. Reads the binary
+// telemetry status frames and AN0 capture frames a run streams out (any
+// console text between them is skipped) and reports:
+//
+//   - Period error: the average time between pulses over windows of steady
+//     frames against the commanded period, as a histogram and per step
+//   - Jitter: how much that average moves from one window to the next
+//   - Missed deadlines: pulses that should have happened but didn't
+//   - Coverage: how much time and how many pulses each part of the period
+//     space got
+//   - Captures: span and droop of every AN0 capture
+//
+// Frames only carry a pulse count, so this is as fine as the timing gets
+// without a logic analyzer on RB0. The log is split into one byte range per
+// thread, each streamed through a fixed buffer, so memory use doesn't grow
+// with the size of the log.
+//
+// Build and run from this directory:
+//   c++ -std=c++17 -O2 -pthread -o plelog plelog.cpp
+//   ./plelog [-j threads] [-c csv_prefix] logfile
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Must match telemetry.h and capture.h
+#define SYNC_BYTE_0             (0xA5)
+#define SYNC_BYTE_1             (0x5A)
+#define FRAME_TYPE_STATUS       (0x01)
+#define FRAME_TYPE_CAPTURE      (0x02)
+#define STATUS_FRAME_SIZE       (20)
+#define CAPTURE_HEADER_SIZE     (17)
+#define CAPTURE_MAX_SAMPLES     (1024)  // Builds can go smaller, not bigger
+#define MAX_FRAME_SIZE          (CAPTURE_HEADER_SIZE + (CAPTURE_MAX_SAMPLES * 2) + 1)
+
+// Valid frames in a row needed to lock on part way through the log
+#define RESYNC_FRAMES           (3)
+#define BUFFER_SIZE             (1 << 20)
+#define MIN_RANGE_SIZE          (1 << 20)
+
+// Pulses a period is averaged over, each one is then good to 1/WINDOW_PULSES
+// of the period
+#define WINDOW_PULSES           (1000)
+#define ERROR_BIN_US            (0.25)
+#define ERROR_BINS              (200)   // +/- 25 us per pulse
+#define JITTER_BIN_US           (0.25)
+#define JITTER_BINS             (200)   // 0-50 us
+#define COVERAGE_BIN_US         (100)
+#define COVERAGE_BINS           ((65535 / COVERAGE_BIN_US) + 1)
+
+typedef struct statusRecord
+{
+    uint16_t            sequence;
+    uint32_t            timestamp;  // us
+    uint16_t            period;     // us
+    uint16_t            step;
+    uint32_t            pulseCount;
+    uint16_t            droppedFrames;
+} statusRecord_t;
+
+typedef struct runningStats
+{
+    uint64_t            count = 0;
+    double              mean = 0.0;
+    double              m2 = 0.0;
+    double              min = INFINITY;
+    double              max = -INFINITY;
+
+    void Add(double value)
+    {
+        double delta = value - mean;
+
+        count++;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+        min = std::fmin(min, value);
+        max = std::fmax(max, value);
+    }
+
+    // Chan et al. parallel combination, so threads can be merged in any order
+    void Merge(const runningStats &other)
+    {
+        double delta;
+        uint64_t total;
+
+        if (other.count == 0)
+        {
+            return;
+        }
+        total = count + other.count;
+        delta = other.mean - mean;
+        mean += delta * other.count / total;
+        m2 += other.m2 + delta * delta * ((double)count * other.count / total);
+        count = total;
+        min = std::fmin(min, other.min);
+        max = std::fmax(max, other.max);
+    }
+
+    double Deviation(void) const
+    {
+        return (count > 1) ? std::sqrt(m2 / (count - 1)) : 0.0;
+    }
+} runningStats_t;
+
+typedef struct phaseStats
+{
+    runningStats_t      measured;   // us between pulses
+    uint16_t            period;     // Last commanded period seen
+    uint64_t            missed;
+} phaseStats_t;
+
+typedef struct coverageBin
+{
+    double              seconds;
+    uint64_t            pulses;
+} coverageBin_t;
+
+typedef struct analysis
+{
+    uint64_t            statusFrames = 0;
+    uint64_t            captureFrames = 0;
+    uint64_t            runStarts = 0;      // Not counting the first
+    uint64_t            lostFrames = 0;     // Sequence gaps, lost on the way to the host
+    uint64_t            droppedFrames = 0;  // Dropped by the emulator for bandwidth
+    uint64_t            transitions = 0;    // Intervals where the period changed
+    uint64_t            missedPulses = 0;
+    double              steadySeconds = 0.0;
+    double              steadyPulses = 0.0;
+    double              expectedPulses = 0.0;
+    runningStats_t      error;
+    runningStats_t      jitter;
+    uint64_t            errorHistogram[ERROR_BINS + 2] = {};   // With under and overflow
+    uint64_t            jitterHistogram[JITTER_BINS + 1] = {}; // With overflow
+    std::map<uint16_t, phaseStats_t> phases;
+    std::vector<coverageBin_t> coverage = std::vector<coverageBin_t>(COVERAGE_BINS);
+    runningStats_t      captureSpan;        // us
+    runningStats_t      captureDroop;       // ADC counts below the pre-trigger average
+    // Ends of this range, pairs across ranges are done when merging
+    bool                haveStatus = false;
+    statusRecord_t      first;
+    statusRecord_t      last;
+    bool                windowOpen = false;
+    statusRecord_t      windowStart;
+    double              lastMeasured = NAN;
+    // Pulses short of the commanded rate since the stretch of steady frames
+    // started, and the most it has been
+    double              stretchDeficit = 0.0;
+    double              stretchWorst = 0.0;
+    // The stretch the range starts in carries on from the range before, so
+    // what it saw up to its first break is kept for merging
+    bool                broken = false;
+    double              leadDeficit = 0.0;
+    double              leadWorst = 0.0;
+    bool                haveLeadAnchor = false;
+    statusRecord_t      leadAnchor;
+    double              leadMeasured = NAN;
+} analysis_t;
+
+static uint16_t Read16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t Read32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Size of the frame starting at p, 0 if it isn't one we know
+static size_t Frame_Size(const uint8_t *p, size_t available)
+{
+    uint16_t sampleCount;
+
+    if ((available < 3) || (p[0] != SYNC_BYTE_0) || (p[1] != SYNC_BYTE_1))
+    {
+        return 0;
+    }
+    if (p[2] == FRAME_TYPE_STATUS)
+    {
+        return STATUS_FRAME_SIZE;
+    }
+    if ((p[2] == FRAME_TYPE_CAPTURE) && (available >= CAPTURE_HEADER_SIZE))
+    {
+        sampleCount = Read16(&p[9]);
+        if (sampleCount <= CAPTURE_MAX_SAMPLES)
+        {
+            return CAPTURE_HEADER_SIZE + (sampleCount * 2) + 1;
+        }
+    }
+
+    return 0;
+}
+
+static bool Frame_IsValid(const uint8_t *p, size_t available)
+{
+    size_t size = Frame_Size(p, available);
+    uint8_t sum = 0;
+
+    if ((size == 0) || (size > available))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < size; i++)
+    {
+        sum += p[i];
+    }
+
+    return (sum == 0);
+}
+
+// Frames don't line up with pulses, so up to one pulse short is just where
+// the frame happened to cut
+static uint64_t Analysis_Missed(double deficit)
+{
+    return (deficit > 1.0) ? (uint64_t)std::ceil(deficit - 1.0) : 0;
+}
+
+// Ends the current stretch of steady frames, the next one starts from scratch
+static void Analysis_Break(analysis_t *analysis)
+{
+    if (!analysis->broken)
+    {
+        analysis->broken = true;
+        analysis->leadDeficit = analysis->stretchDeficit;
+        analysis->leadWorst = analysis->stretchWorst;
+    }
+    analysis->stretchDeficit = 0.0;
+    analysis->stretchWorst = 0.0;
+    analysis->windowOpen = false;
+    analysis->lastMeasured = NAN;
+}
+
+static void Analysis_AddJitter(analysis_t *analysis, double a, double b)
+{
+    double jitter = std::fabs(b - a);
+    int bin = (int)(jitter / JITTER_BIN_US);
+
+    analysis->jitter.Add(jitter);
+    analysis->jitterHistogram[(bin > JITTER_BINS) ? JITTER_BINS : bin]++;
+}
+
+// Measures the average period over a window of steady frames
+static void Analysis_AddWindow(analysis_t *analysis, const statusRecord_t *a, const statusRecord_t *b)
+{
+    double dt = (double)(uint32_t)(b->timestamp - a->timestamp);
+    double dp = (double)(b->pulseCount - a->pulseCount);
+    double measured = dt / dp;
+    double error = measured - a->period;
+    int bin;
+
+    analysis->error.Add(error);
+    analysis->phases[a->step].measured.Add(measured);
+    bin = (int)std::floor(error / ERROR_BIN_US) + (ERROR_BINS / 2) + 1;
+    bin = (bin < 0) ? 0 : ((bin > (ERROR_BINS + 1)) ? (ERROR_BINS + 1) : bin);
+    analysis->errorHistogram[bin]++;
+
+    if (!std::isnan(analysis->lastMeasured))
+    {
+        Analysis_AddJitter(analysis, analysis->lastMeasured, measured);
+    }
+    else if (!analysis->broken)
+    {
+        // Its jitter is against the window before, in the range before
+        analysis->leadMeasured = measured;
+    }
+    analysis->lastMeasured = measured;
+}
+
+// Returns false if the pair ends the stretch of steady frames
+static bool Analysis_AddPair(analysis_t *analysis, const statusRecord_t *a, const statusRecord_t *b)
+{
+    double dt;
+    double dp;
+    double expected;
+    uint64_t missed = 0;
+    phaseStats_t *phase;
+
+    // Every run starts its frames and pulse count from zero, a resumed run
+    // only its frames
+    if (((b->sequence == 0) && (a->sequence != UINT16_MAX)) || (b->pulseCount < a->pulseCount))
+    {
+        analysis->runStarts++;
+        Analysis_Break(analysis);
+        return false;
+    }
+    analysis->lostFrames += (uint16_t)(b->sequence - a->sequence - 1);
+    if (b->droppedFrames >= a->droppedFrames)
+    {
+        analysis->droppedFrames += b->droppedFrames - a->droppedFrames;
+    }
+
+    dt = (double)(uint32_t)(b->timestamp - a->timestamp);
+    dp = (double)(b->pulseCount - a->pulseCount);
+    if (a->period != 0)
+    {
+        analysis->coverage[a->period / COVERAGE_BIN_US].seconds += dt / 1e6;
+        analysis->coverage[a->period / COVERAGE_BIN_US].pulses += (uint64_t)dp;
+    }
+    if ((a->period == 0) || (a->period != b->period) || (a->step != b->step) || (dt == 0.0))
+    {
+        analysis->transitions++;
+        Analysis_Break(analysis);
+        return false;
+    }
+
+    // Counted against the whole stretch rather than each interval, a single
+    // missed pulse is less than the cut of either frame around it
+    expected = dt / a->period;
+    analysis->stretchDeficit += expected - dp;
+    if (analysis->stretchDeficit > analysis->stretchWorst)
+    {
+        missed = Analysis_Missed(analysis->stretchDeficit) - Analysis_Missed(analysis->stretchWorst);
+        analysis->stretchWorst = analysis->stretchDeficit;
+    }
+    analysis->missedPulses += missed;
+    analysis->steadySeconds += dt / 1e6;
+    analysis->steadyPulses += dp;
+    analysis->expectedPulses += expected;
+    phase = &analysis->phases[a->step];
+    phase->period = a->period;
+    phase->missed += missed;
+
+    // That same cut makes a single interval far too coarse to time, so
+    // periods are measured over windows of WINDOW_PULSES. Windows start on
+    // the frame where the count passes a multiple of it, so they land in the
+    // same place however the log is split.
+    if ((b->pulseCount / WINDOW_PULSES) != (a->pulseCount / WINDOW_PULSES))
+    {
+        if (analysis->windowOpen)
+        {
+            Analysis_AddWindow(analysis, &analysis->windowStart, b);
+        }
+        else if (!analysis->broken)
+        {
+            analysis->haveLeadAnchor = true;
+            analysis->leadAnchor = *b;
+        }
+        analysis->windowOpen = true;
+        analysis->windowStart = *b;
+    }
+
+    return true;
+}
+
+static void Analysis_AddStatus(analysis_t *analysis, const uint8_t *p)
+{
+    statusRecord_t record;
+
+    record.sequence = Read16(&p[3]);
+    record.timestamp = Read32(&p[5]);
+    record.period = Read16(&p[9]);
+    record.step = Read16(&p[11]);
+    record.pulseCount = Read32(&p[13]);
+    record.droppedFrames = Read16(&p[17]);
+
+    analysis->statusFrames++;
+    if (!analysis->haveStatus)
+    {
+        analysis->haveStatus = true;
+        analysis->first = record;
+    }
+    else
+    {
+        Analysis_AddPair(analysis, &analysis->last, &record);
+    }
+    analysis->last = record;
+}
+
+static void Analysis_AddCapture(analysis_t *analysis, const uint8_t *p)
+{
+    uint16_t sampleCount = Read16(&p[9]);
+    uint16_t triggerIndex = Read16(&p[11]);
+    const uint8_t *samples = &p[CAPTURE_HEADER_SIZE];
+    double preSum = 0.0;
+    uint16_t postMin = UINT16_MAX;
+
+    analysis->captureFrames++;
+    analysis->captureSpan.Add(Read32(&p[13]));
+    if ((triggerIndex == 0) || (triggerIndex >= sampleCount))
+    {
+        return;
+    }
+    for (uint16_t i = 0; i < sampleCount; i++)
+    {
+        uint16_t sample = Read16(&samples[i * 2]);
+
+        if (i < triggerIndex)
+        {
+            preSum += sample;
+        }
+        else if (sample < postMin)
+        {
+            postMin = sample;
+        }
+    }
+    analysis->captureDroop.Add((preSum / triggerIndex) - postMin);
+}
+
+// Handles every frame that starts in [start, end), reading past end to
+// finish the last one, start has to be the start of a frame or console text.
+// With no analysis it instead starts blind and returns where it locks on
+// after RESYNC_FRAMES back to back frames, so the tail of a frame from the
+// range before can't be mistaken for one, looking as far as the end of the
+// log if need be.
+// Each range is then parsed from where it locked on up to where the next one
+// did, so no frame is skipped or counted twice however the log is split.
+static uint64_t Log_ParseRange(const char *path, uint64_t start, uint64_t end, analysis_t *analysis)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> buffer(BUFFER_SIZE);
+    uint64_t bufferOffset = start;  // File offset of buffer[0]
+    size_t length = 0;
+    size_t position = 0;
+    bool endOfFile = false;
+
+    file.seekg((std::streamoff)start);
+    for (;;)
+    {
+        // Keep enough ahead to check a run of whole frames
+        if (((length - position) < (RESYNC_FRAMES * MAX_FRAME_SIZE)) && !endOfFile)
+        {
+            std::memmove(buffer.data(), buffer.data() + position, length - position);
+            bufferOffset += position;
+            length -= position;
+            position = 0;
+            file.read((char *)buffer.data() + length, (std::streamsize)(buffer.size() - length));
+            length += (size_t)file.gcount();
+            endOfFile = !file;
+        }
+        if (position >= length)
+        {
+            break;
+        }
+        if (((bufferOffset + position) >= end) && (analysis != NULL))
+        {
+            break;
+        }
+
+        const uint8_t *p = buffer.data() + position;
+        size_t available = length - position;
+
+        if (!Frame_IsValid(p, available))
+        {
+            position++;
+            continue;
+        }
+        if (analysis == NULL)
+        {
+            size_t offset = 0;
+            int chained;
+
+            for (chained = 0; chained < RESYNC_FRAMES; chained++)
+            {
+                if (!Frame_IsValid(p + offset, available - offset))
+                {
+                    break;
+                }
+                offset += Frame_Size(p + offset, available - offset);
+            }
+            // Running out of log counts as the end of the chain
+            if ((chained < RESYNC_FRAMES) && (offset < available))
+            {
+                position++;
+                continue;
+            }
+            break;
+        }
+
+        if (p[2] == FRAME_TYPE_STATUS)
+        {
+            Analysis_AddStatus(analysis, p);
+        }
+        else
+        {
+            Analysis_AddCapture(analysis, p);
+        }
+        position += Frame_Size(p, available);
+    }
+
+    return bufferOffset + position;
+}
+
+// Folds the next range into the running total, in log order
+static void Analysis_Merge(analysis_t *total, const analysis_t *next)
+{
+    // The interval that straddles the two ranges comes before anything in the
+    // next one
+    if (total->haveStatus && next->haveStatus)
+    {
+        double leadDeficit = next->broken ? next->leadDeficit : next->stretchDeficit;
+        double leadWorst = next->broken ? next->leadWorst : next->stretchWorst;
+        double worst;
+        uint64_t missed;
+        bool steady;
+
+        steady = Analysis_AddPair(total, &total->last, &next->first);
+
+        // The window open at the end of this range closes on the first one
+        // the next range opened
+        if (steady && next->haveLeadAnchor)
+        {
+            if (total->windowOpen)
+            {
+                Analysis_AddWindow(total, &total->windowStart, &next->leadAnchor);
+            }
+            if (!std::isnan(total->lastMeasured) && !std::isnan(next->leadMeasured))
+            {
+                Analysis_AddJitter(total, total->lastMeasured, next->leadMeasured);
+            }
+        }
+        if (!steady || next->broken)
+        {
+            total->windowOpen = next->windowOpen;
+            total->windowStart = next->windowStart;
+            total->lastMeasured = next->lastMeasured;
+        }
+        else if (next->haveLeadAnchor)
+        {
+            total->windowOpen = true;
+            total->windowStart = next->windowStart;
+            if (!std::isnan(next->lastMeasured))
+            {
+                total->lastMeasured = next->lastMeasured;
+            }
+        }
+
+        // The next range counted the stretch it started in from zero, recount
+        // it carrying on from this one's
+        worst = std::max(total->stretchWorst, total->stretchDeficit + leadWorst);
+        missed = Analysis_Missed(worst) - Analysis_Missed(total->stretchWorst);
+        if ((missed != 0) || (Analysis_Missed(leadWorst) != 0))
+        {
+            phaseStats_t *phase = &total->phases[next->first.step];
+
+            total->missedPulses += missed;
+            total->missedPulses -= Analysis_Missed(leadWorst);
+            phase->missed += missed;
+            phase->missed -= Analysis_Missed(leadWorst);
+        }
+        if (next->broken)
+        {
+            total->stretchDeficit = next->stretchDeficit;
+            total->stretchWorst = next->stretchWorst;
+        }
+        else
+        {
+            total->stretchDeficit += leadDeficit;
+            total->stretchWorst = worst;
+        }
+    }
+
+    total->statusFrames += next->statusFrames;
+    total->captureFrames += next->captureFrames;
+    total->runStarts += next->runStarts;
+    total->lostFrames += next->lostFrames;
+    total->droppedFrames += next->droppedFrames;
+    total->transitions += next->transitions;
+    total->missedPulses += next->missedPulses;
+    total->steadySeconds += next->steadySeconds;
+    total->steadyPulses += next->steadyPulses;
+    total->expectedPulses += next->expectedPulses;
+    total->error.Merge(next->error);
+    total->jitter.Merge(next->jitter);
+    for (int i = 0; i < (ERROR_BINS + 2); i++)
+    {
+        total->errorHistogram[i] += next->errorHistogram[i];
+    }
+    for (int i = 0; i < (JITTER_BINS + 1); i++)
+    {
+        total->jitterHistogram[i] += next->jitterHistogram[i];
+    }
+    for (const auto &entry : next->phases)
+    {
+        phaseStats_t *phase = &total->phases[entry.first];
+
+        phase->measured.Merge(entry.second.measured);
+        phase->period = entry.second.period;
+        phase->missed += entry.second.missed;
+    }
+    for (int i = 0; i < COVERAGE_BINS; i++)
+    {
+        total->coverage[i].seconds += next->coverage[i].seconds;
+        total->coverage[i].pulses += next->coverage[i].pulses;
+    }
+    total->captureSpan.Merge(next->captureSpan);
+    total->captureDroop.Merge(next->captureDroop);
+
+    if (!next->haveStatus)
+    {
+        return;
+    }
+    if (!total->haveStatus)
+    {
+        total->haveStatus = true;
+        total->first = next->first;
+        total->stretchDeficit = next->stretchDeficit;
+        total->stretchWorst = next->stretchWorst;
+        total->windowOpen = next->windowOpen;
+        total->windowStart = next->windowStart;
+        total->lastMeasured = next->lastMeasured;
+    }
+    total->last = next->last;
+}
+
+static void Report_Bar(uint64_t count, uint64_t largest)
+{
+    int width = (largest == 0) ? 0 : (int)((40 * count + largest - 1) / largest);
+
+    for (int i = 0; i < width; i++)
+    {
+        putchar('#');
+    }
+    putchar('\n');
+}
+
+static void Report_Print(const analysis_t *analysis)
+{
+    uint64_t largest = 0;
+    unsigned int visited = 0;
+    unsigned int span = 0;
+    int lowest = -1;
+    int highest = -1;
+
+    printf("Runs:                 %llu\n", (unsigned long long)(analysis->haveStatus ? analysis->runStarts + 1 : 0));
+    printf("Status frames:        %llu (%llu lost on the link, %llu dropped by the emulator)\n",
+           (unsigned long long)analysis->statusFrames, (unsigned long long)analysis->lostFrames, (unsigned long long)analysis->droppedFrames);
+    printf("Steady time:          %.1f s, %.0f pulses\n", analysis->steadySeconds, analysis->steadyPulses);
+    if (analysis->expectedPulses > 0.0)
+    {
+        printf("Pulse rate:           %+.1f ppm from commanded\n", ((analysis->steadyPulses / analysis->expectedPulses) - 1.0) * 1e6);
+    }
+    printf("Period error:         mean %+.3f us, sd %.3f us, %+.3f to %+.3f us\n",
+           analysis->error.mean, analysis->error.Deviation(), analysis->error.min, analysis->error.max);
+    printf("Window jitter:        mean %.3f us, max %.3f us\n", analysis->jitter.mean, analysis->jitter.max);
+    printf("Missed deadlines:     %llu pulses\n", (unsigned long long)analysis->missedPulses);
+    printf("Period changes:       %llu intervals left out of the error figures\n", (unsigned long long)analysis->transitions);
+
+    printf("\nPeriod error per pulse (us)\n");
+    for (int i = 0; i < (ERROR_BINS + 2); i++)
+    {
+        largest = std::max(largest, analysis->errorHistogram[i]);
+    }
+    for (int i = 0; i < (ERROR_BINS + 2); i++)
+    {
+        if (analysis->errorHistogram[i] == 0)
+        {
+            continue;
+        }
+        if (i == 0)
+        {
+            printf("        < %+7.2f %10llu ", -(ERROR_BINS / 2) * ERROR_BIN_US, (unsigned long long)analysis->errorHistogram[i]);
+        }
+        else if (i == (ERROR_BINS + 1))
+        {
+            printf("       >= %+7.2f %10llu ", (ERROR_BINS / 2) * ERROR_BIN_US, (unsigned long long)analysis->errorHistogram[i]);
+        }
+        else
+        {
+            printf("%+7.2f..%+7.2f %10llu ", (i - 1 - (ERROR_BINS / 2)) * ERROR_BIN_US, (i - (ERROR_BINS / 2)) * ERROR_BIN_US,
+                   (unsigned long long)analysis->errorHistogram[i]);
+        }
+        Report_Bar(analysis->errorHistogram[i], largest);
+    }
+
+    printf("\nJitter between windows (us)\n");
+    largest = 0;
+    for (int i = 0; i < (JITTER_BINS + 1); i++)
+    {
+        largest = std::max(largest, analysis->jitterHistogram[i]);
+    }
+    for (int i = 0; i < (JITTER_BINS + 1); i++)
+    {
+        if (analysis->jitterHistogram[i] == 0)
+        {
+            continue;
+        }
+        if (i == JITTER_BINS)
+        {
+            printf("      >= %6.2f %10llu ", JITTER_BINS * JITTER_BIN_US, (unsigned long long)analysis->jitterHistogram[i]);
+        }
+        else
+        {
+            printf("%6.2f..%6.2f %10llu ", i * JITTER_BIN_US, (i + 1) * JITTER_BIN_US, (unsigned long long)analysis->jitterHistogram[i]);
+        }
+        Report_Bar(analysis->jitterHistogram[i], largest);
+    }
+
+    printf("\n Step  Period (us)  Intervals  Mean (us)   Min (us)   Max (us)    SD (us)  Missed\n");
+    for (const auto &entry : analysis->phases)
+    {
+        const phaseStats_t *phase = &entry.second;
+
+        printf("%5u  %11u %10llu %10.2f %10.2f %10.2f %10.3f %7llu\n", entry.first, phase->period,
+               (unsigned long long)phase->measured.count, phase->measured.mean, phase->measured.min, phase->measured.max,
+               phase->measured.Deviation(), (unsigned long long)phase->missed);
+    }
+
+    for (int i = 0; i < COVERAGE_BINS; i++)
+    {
+        if (analysis->coverage[i].pulses != 0)
+        {
+            lowest = (lowest < 0) ? i : lowest;
+            highest = i;
+            visited++;
+        }
+    }
+    span = (lowest < 0) ? 0 : (highest - lowest + 1);
+    printf("\nCoverage:             %u of %u %d us bins between %d and %d us have pulses\n", visited, span, COVERAGE_BIN_US,
+           (lowest < 0) ? 0 : lowest * COVERAGE_BIN_US, (highest < 0) ? 0 : (highest + 1) * COVERAGE_BIN_US);
+
+    printf("\nCaptures:             %llu\n", (unsigned long long)analysis->captureFrames);
+    if (analysis->captureFrames != 0)
+    {
+        printf("Capture span:         mean %.0f us, %.0f to %.0f us\n", analysis->captureSpan.mean, analysis->captureSpan.min, analysis->captureSpan.max);
+        printf("Droop after trigger:  mean %.1f counts, worst %.1f counts\n", analysis->captureDroop.mean, analysis->captureDroop.max);
+    }
+}
+
+static bool Report_WriteCsv(const analysis_t *analysis, const std::string &prefix)
+{
+    FILE *file;
+
+    file = fopen((prefix + "-error.csv").c_str(), "w");
+    if (file == NULL)
+    {
+        return false;
+    }
+    fprintf(file, "low_us,high_us,count\n");
+    for (int i = 1; i <= ERROR_BINS; i++)
+    {
+        fprintf(file, "%.2f,%.2f,%llu\n", (i - 1 - (ERROR_BINS / 2)) * ERROR_BIN_US, (i - (ERROR_BINS / 2)) * ERROR_BIN_US,
+                (unsigned long long)analysis->errorHistogram[i]);
+    }
+    fclose(file);
+
+    file = fopen((prefix + "-jitter.csv").c_str(), "w");
+    if (file == NULL)
+    {
+        return false;
+    }
+    fprintf(file, "low_us,high_us,count\n");
+    for (int i = 0; i < JITTER_BINS; i++)
+    {
+        fprintf(file, "%.2f,%.2f,%llu\n", i * JITTER_BIN_US, (i + 1) * JITTER_BIN_US, (unsigned long long)analysis->jitterHistogram[i]);
+    }
+    fclose(file);
+
+    file = fopen((prefix + "-phases.csv").c_str(), "w");
+    if (file == NULL)
+    {
+        return false;
+    }
+    fprintf(file, "step,period_us,windows,mean_us,min_us,max_us,sd_us,missed\n");
+    for (const auto &entry : analysis->phases)
+    {
+        const phaseStats_t *phase = &entry.second;
+
+        fprintf(file, "%u,%u,%llu,%.3f,%.3f,%.3f,%.4f,%llu\n", entry.first, phase->period, (unsigned long long)phase->measured.count,
+                phase->measured.mean, phase->measured.min, phase->measured.max, phase->measured.Deviation(),
+                (unsigned long long)phase->missed);
+    }
+    fclose(file);
+
+    file = fopen((prefix + "-coverage.csv").c_str(), "w");
+    if (file == NULL)
+    {
+        return false;
+    }
+    fprintf(file, "low_us,high_us,seconds,pulses\n");
+    for (int i = 0; i < COVERAGE_BINS; i++)
+    {
+        fprintf(file, "%d,%d,%.3f,%llu\n", i * COVERAGE_BIN_US, (i + 1) * COVERAGE_BIN_US, analysis->coverage[i].seconds,
+                (unsigned long long)analysis->coverage[i].pulses);
+    }
+    fclose(file);
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int threads = std::thread::hardware_concurrency();
+    const char *path = NULL;
+    std::string csvPrefix;
+    uint64_t size;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-j") == 0) && ((i + 1) < argc))
+        {
+            threads = (unsigned int)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-c") == 0) && ((i + 1) < argc))
+        {
+            csvPrefix = argv[++i];
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+    if (path == NULL)
+    {
+        fprintf(stderr, "usage: %s [-j threads] [-c csv_prefix] logfile\n", argv[0]);
+        return 1;
+    }
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        fprintf(stderr, "can't open %s\n", path);
+        return 1;
+    }
+    size = (uint64_t)file.tellg();
+    file.close();
+
+    // Small logs aren't worth splitting
+    if ((threads == 0) || ((size / threads) < MIN_RANGE_SIZE))
+    {
+        threads = (unsigned int)std::max<uint64_t>(1, size / MIN_RANGE_SIZE);
+        threads = std::min(threads, std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    // Find where each range locks on, then parse between them
+    std::vector<uint64_t> starts(threads + 1);
+    std::vector<analysis_t> ranges(threads);
+    std::vector<std::thread> workers;
+    starts[0] = 0;
+    starts[threads] = size;
+    for (unsigned int t = 1; t < threads; t++)
+    {
+        workers.emplace_back([&starts, path, size, threads, t]()
+        {
+            starts[t] = Log_ParseRange(path, (size * t) / threads, size, NULL);
+        });
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+    for (unsigned int t = 0; t < threads; t++)
+    {
+        workers.emplace_back(Log_ParseRange, path, starts[t], std::max(starts[t], starts[t + 1]), &ranges[t]);
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    analysis_t total;
+    for (const auto &range : ranges)
+    {
+        Analysis_Merge(&total, &range);
+    }
+
+    printf("%s: %llu bytes, %u threads\n\n", path, (unsigned long long)size, threads);
+    Report_Print(&total);
+    if (!csvPrefix.empty() && !Report_WriteCsv(&total, csvPrefix))
+    {
+        fprintf(stderr, "can't write %s-*.csv\n", csvPrefix.c_str());
+        return 1;
+    }
+
+    return 0;
+}
\ No newline at end of file
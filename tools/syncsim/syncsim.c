@@ -0,0 +1,224 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Michel Kakulphimp
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+// Host simulation of the multi-board sync protocol. Runs one leader and a
+// number of virtual followers, each with its own crystal error and interrupt
+// latency jitter, through the same SyncLoop code the firmware uses. Each
+// follower is modelled the way sync.c drives it: TMR3 loaded from
+// SyncLoop_StartTimerValue on the start edge (or left unaligned when the
+// edge is missed), read late on every periodic edge, and wound by at most one
+// pending correction per compare match. Skew is measured in true time
+// against where the leader's match plus our stagger says it should be.
+//
+// Build and run from this directory:
+//   cc -std=c99 -O2 -I../.. -o syncsim syncsim.c ../../syncloop.c -lm
+//   ./syncsim [followers] [period_us] [stagger_us] [intervals]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "syncloop.h"
+
+#define TICKS_PER_US        (1.5)   // Timer3 at FOSC/4/8
+#define EDGE_INTERVAL       (64)    // Leader pulses between sync edges
+#define MAX_FOLLOWERS       (64)
+#define LATENCY_JITTER_TICKS (1)    // Either way of SYNC_ISR_LATENCY_TICKS
+#define MISSED_START_PERCENT (25)   // Followers that start unaligned
+#define PASS_LIMIT_US       (5.0)   // Jitter of both latencies and a tick of quantization, as the integral stacks it up
+
+typedef struct virtualBoard
+{
+    unsigned int        boardId;    // 0 is the leader's phase
+    double              ppm;        // Crystal error
+    double              ticksPerUs; // Timer3 rate in true time
+    uint16_t            staggerTicks;
+    uint16_t            edgeStaggerTicks;
+    double              lastMatch;  // Time of last compare match (us, true time)
+    double              nextMatch;
+    int16_t             woundBack;  // Taken off TMR3 at the last match
+    bool                correctionPending;
+    int16_t             pendingCorrection;
+    unsigned int        skipped;    // Corrections dropped while one was pending
+    syncLoop_t          loop;
+    double              worstSkew;
+    double              sumSquares;
+    unsigned int        samples;
+} virtualBoard_t;
+
+static double Random_Uniform(double low, double high)
+{
+    return low + ((high - low) * rand()) / RAND_MAX;
+}
+
+// Interrupt entry in ticks of whoever takes it
+static double Random_LatencyTicks(void)
+{
+    return SYNC_ISR_LATENCY_TICKS + (rand() % ((2 * LATENCY_JITTER_TICKS) + 1)) - LATENCY_JITTER_TICKS;
+}
+
+// Sync_CompareIsr on every match up to the given time
+static void Board_RunUntil(virtualBoard_t *board, uint16_t periodTicks, double time)
+{
+    while (board->nextMatch <= time)
+    {
+        board->lastMatch = board->nextMatch;
+        board->woundBack = 0;
+        if (board->correctionPending)
+        {
+            board->woundBack = board->pendingCorrection;
+            board->correctionPending = false;
+        }
+        board->nextMatch = board->lastMatch + ((periodTicks + board->woundBack) / board->ticksPerUs);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int followers = (argc > 1) ? atoi(argv[1]) : 8;
+    double period = (argc > 2) ? atof(argv[2]) : 10000.0;
+    double stagger = (argc > 3) ? atof(argv[3]) : 0.0;
+    unsigned int intervals = (argc > 4) ? atoi(argv[4]) : 200;
+    uint16_t periodTicks = (uint16_t)(period * TICKS_PER_US);
+    double leaderPeriod = periodTicks / TICKS_PER_US;
+    virtualBoard_t boards[MAX_FOLLOWERS];
+    unsigned int failures = 0;
+
+    if ((followers == 0) || (followers > MAX_FOLLOWERS))
+    {
+        fprintf(stderr, "followers must be 1-%d\n", MAX_FOLLOWERS);
+        return 1;
+    }
+
+    srand(1);
+    for (unsigned int b = 0; b < followers; b++)
+    {
+        virtualBoard_t *board = &boards[b];
+
+        board->boardId = b;
+        board->ppm = Random_Uniform(-50.0, 50.0);
+        board->ticksPerUs = TICKS_PER_US * (1.0 + board->ppm * 1e-6);
+        // Same sums as Sync_Start
+        board->staggerTicks = (uint16_t)((((uint32_t)stagger * board->boardId * 3) / 2) % periodTicks);
+        board->edgeStaggerTicks = SyncLoop_EdgeStaggerTicks(board->staggerTicks, periodTicks);
+        board->woundBack = 0;
+        board->correctionPending = false;
+        board->pendingCorrection = 0;
+        board->skipped = 0;
+        board->worstSkew = 0.0;
+        board->sumSquares = 0.0;
+        board->samples = 0;
+        SyncLoop_Reset(&board->loop);
+
+        // The leader's start edge and first period are at 0. Sync_EdgeIsr
+        // loads TMR3 and it counts up through any wrap to CCPR1, a follower
+        // that misses the edge times out and starts wherever it is.
+        if ((rand() % 100) < MISSED_START_PERCENT)
+        {
+            board->lastMatch = Random_Uniform(0.0, period);
+        }
+        else
+        {
+            board->lastMatch = (Random_LatencyTicks() / board->ticksPerUs) - (periodTicks / board->ticksPerUs)
+                               + ((uint16_t)(periodTicks - SyncLoop_StartTimerValue(board->staggerTicks)) / board->ticksPerUs);
+        }
+        board->nextMatch = board->lastMatch + (periodTicks / board->ticksPerUs);
+    }
+
+    printf("%u followers, %.0f us period, %.0f us stagger per board id, edge every %d pulses\n",
+           followers, period, stagger, EDGE_INTERVAL);
+
+    for (unsigned int interval = 1; interval <= intervals; interval++)
+    {
+        // The leader runs on true time, its edge goes out of the interrupt
+        // on its compare match
+        double leaderMatch = interval * EDGE_INTERVAL * leaderPeriod;
+        double edgeTime = leaderMatch + (Random_LatencyTicks() / TICKS_PER_US);
+
+        for (unsigned int b = 0; b < followers; b++)
+        {
+            virtualBoard_t *board = &boards[b];
+            double readTime = edgeTime + (Random_LatencyTicks() / board->ticksPerUs);
+            uint16_t timerValue;
+            int16_t correction;
+            double skew;
+
+            // Sync_EdgeIsr reads TMR3, Sync_Service hands it to the loop
+            Board_RunUntil(board, periodTicks, readTime);
+            timerValue = (uint16_t)((int32_t)floor((readTime - board->lastMatch) * board->ticksPerUs) - board->woundBack);
+            correction = SyncLoop_Update(&board->loop, timerValue, periodTicks, board->edgeStaggerTicks);
+            if (!board->correctionPending)
+            {
+                board->pendingCorrection = correction;
+                board->correctionPending = true;
+            }
+            else
+            {
+                board->skipped++;
+            }
+
+            // True skew of the match just before the edge from where we
+            // want it to be
+            skew = fmod(board->lastMatch - leaderMatch - (board->staggerTicks / TICKS_PER_US), leaderPeriod);
+            if (skew > (leaderPeriod / 2))
+            {
+                skew -= leaderPeriod;
+            }
+            else if (skew <= -(leaderPeriod / 2))
+            {
+                skew += leaderPeriod;
+            }
+            if (interval > (intervals / 2))
+            {
+                board->sumSquares += skew * skew;
+                board->samples++;
+                if (fabs(skew) > board->worstSkew)
+                {
+                    board->worstSkew = fabs(skew);
+                }
+            }
+            if ((interval <= 5) || ((interval % 50) == 0))
+            {
+                printf("interval %4u board %2u skew %10.2f us (loop reads %8.2f us)\n", interval, board->boardId, skew,
+                       board->loop.error / TICKS_PER_US);
+            }
+        }
+    }
+
+    printf("\nboard      ppm   rms skew (us)   worst skew (us)   skipped\n");
+    for (unsigned int b = 0; b < followers; b++)
+    {
+        double rms = sqrt(boards[b].sumSquares / boards[b].samples);
+        printf("%5u %8.2f %15.2f %17.2f %9u%s\n", boards[b].boardId, boards[b].ppm, rms, boards[b].worstSkew, boards[b].skipped,
+               (boards[b].worstSkew > PASS_LIMIT_US) ? "  FAIL" : "");
+        if (boards[b].worstSkew > PASS_LIMIT_US)
+        {
+            failures++;
+        }
+    }
+
+    return (failures == 0) ? 0 : 1;
+}
\ No newline at end of file
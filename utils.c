@@ -26,10 +26,25 @@
 #include <stdint.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stdbool.h>
 
 #include "utils.h"
+#include "profile.h"
+#include "scheduler.h"
+#include "calibration.h"
 
-uint32_t uptimeTicksMicroSeconds;
+// The microsecond uptime wraps after about 71 minutes, soaks that run for
+// days time themselves in milliseconds (49 days) or seconds instead
+volatile uint32_t uptimeTicksMicroSeconds;
+volatile uint32_t uptimeMilliseconds;
+volatile uint32_t uptimeSeconds;
+volatile uint32_t pulseCount;
+volatile uint16_t pulseLatencyWorst;   // Timer3 ticks from match to ISR
+
+static volatile uint16_t stagedCompareValue;
+static volatile bool compareValueStaged;
+static uint8_t uptimeTicksInMillisecond;
+static uint16_t uptimeMillisecondsInSecond;
 
 void putch(char c)
 {
@@ -41,7 +56,11 @@ char getch(void)
 {
     char c;
     
-    while (!RCIF); // Wait for data to be received
+    // Background work gets the time spent waiting for data
+    while (!RCIF)
+    {
+        Scheduler_Run();
+    }
     c = (char)RCREG1;
     
     return c;
@@ -63,11 +82,11 @@ int scanf(const char *format, ...)
     uint16_t i = 0;
     uint16_t j = 0;
     uint16_t ret = 0;
-    char buff[128] = {0};
+    char buff[SCANF_BUFFER_LENGTH] = {0};
     char c;
     char *endPointer;
 
-    // Read in line
+    // Read in line, keeping room for the terminator
     do
     {
         c = (char)getche();
@@ -75,11 +94,11 @@ int scanf(const char *format, ...)
         {
             buff[i] = 0;
         }
-        else
+        else if (i < (SCANF_BUFFER_LENGTH - 1))
         {
             buff[i] = c;
+            i++;
         }
-        i++;
     }
     while(c != '\r');
 
@@ -135,9 +154,56 @@ void Util_GeneratePulseRB0(void)
     LATBbits.LATB0 = 1;
 }
 
+// Radical inverse of index in base 2 (van der Corput), as a fraction of
+// 65536. Only the low 16 bits of the index count, so it repeats every 65536
+// points, by which time it has hit every value a 16-bit timer can tell apart.
+uint16_t Util_VanDerCorput(uint32_t index)
+{
+    uint16_t bits = (uint16_t)index;
+    uint16_t reversed = 0;
+
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        reversed = (reversed << 1) | (bits & 1);
+        bits >>= 1;
+    }
+
+    return reversed;
+}
+
+uint16_t Util_MicrosecondsToTicks(uint16_t microseconds)
+{
+    uint32_t ticks;
+
+    // 2 us for every 3 ticks, rounded, done in 32 bits since anything over
+    // 21845 us overflows an int
+    ticks = (((uint32_t)microseconds * 3) + 1) / 2;
+    if (ticks > UINT16_MAX)
+    {
+        ticks = UINT16_MAX;
+    }
+
+    return (uint16_t)ticks;
+}
+
+// Restarts the period from scratch, only for starting and stopping. Use
+// Util_StageCompareValue to change the period of a running workload.
 void Util_SetNewCompareValue(uint16_t desiredPeriod)
 {
-    if (desiredPeriod == 0)
+    PROFILE_START(PROFILE_REGION_SET_COMPARE);
+
+    // A full restart replaces anything waiting for the next match
+    compareValueStaged = false;
+    Util_SetCompareTicks((desiredPeriod == 0) ? 0 : Calibration_PeriodToTicks(desiredPeriod));
+
+    PROFILE_STOP(PROFILE_REGION_SET_COMPARE);
+}
+
+// Same as Util_SetNewCompareValue but with the raw compare value, calibration
+// needs periods without its own correction in them
+void Util_SetCompareTicks(uint16_t ticks)
+{
+    if (ticks == 0)
     {
         // Disable comparator
         CCP1CONbits.CCP1M = 0x0;    // 0b0000 = Capture/Compare/PWM off (resets ECCPx module)
@@ -147,8 +213,7 @@ void Util_SetNewCompareValue(uint16_t desiredPeriod)
     {
         // Disable comparator
         CCP1CONbits.CCP1M = 0x0; // 0b0000 = Capture/Compare/PWM off (resets ECCPx module)
-        // 2 us for every 3 ticks
-        CCPR1 = (desiredPeriod * 3)/2;
+        CCPR1 = ticks;
         // Reset TMR3 value
         TMR3 = 0;
         // Enable comparator
@@ -156,14 +221,148 @@ void Util_SetNewCompareValue(uint16_t desiredPeriod)
     }
 }
 
+void Util_StageCompareValue(uint16_t desiredPeriod)
+{
+    bool interruptEnabled;
+
+    // Nothing is running to hand over from, just start it up
+    if ((desiredPeriod == 0) || (CCP1CONbits.CCP1M != 0xB))
+    {
+        Util_SetNewCompareValue(desiredPeriod);
+        return;
+    }
+
+    // Keep the interrupt out while both halves are written, the comparator
+    // itself keeps running
+    interruptEnabled = PIE1bits.CCP1IE;
+    PIE1bits.CCP1IE = 0;
+    stagedCompareValue = Calibration_PeriodToTicks(desiredPeriod);
+    compareValueStaged = true;
+    // Leave it off if a pulse target has shut pulsing down
+    PIE1bits.CCP1IE = interruptEnabled;
+}
+
+void Util_ApplyStagedCompareValue(void)
+{
+    // Called from the ECCP1 interrupt, TMR3 was just reset by the special
+    // event so the new value sets the length of the period now starting.
+    // The period that just ended was exactly what it was set up to be and
+    // no match can be missed, as long as this runs before TMR3 counts up to
+    // the new value.
+    if (compareValueStaged)
+    {
+        CCPR1 = stagedCompareValue;
+        compareValueStaged = false;
+    }
+}
+
 void Util_ToggleRB0(void)
 {
     LATBbits.LATB0 ^= 1;
 }
 
+// Timer3 ticks left until the next compare match, UINT16_MAX if no pulses
+// are coming. Call with interrupts off or the answer may already be stale.
+uint16_t Util_GetTicksToNextMatch(void)
+{
+    if ((CCP1CONbits.CCP1M != 0xB) || !PIE1bits.CCP1IE)
+    {
+        return UINT16_MAX;
+    }
+
+    // Sync followers can pull TMR3 back through zero, the subtraction wraps
+    // the same way
+    return (uint16_t)(CCPR1 - TMR3);
+}
+
+// Called from the Timer2 interrupt every 10 us
+void Util_UptimeTickIsr(void)
+{
+    uptimeTicksMicroSeconds += 10;
+    if (++uptimeTicksInMillisecond >= 100)
+    {
+        uptimeTicksInMillisecond = 0;
+        uptimeMilliseconds++;
+        if (++uptimeMillisecondsInSecond >= 1000)
+        {
+            uptimeMillisecondsInSecond = 0;
+            uptimeSeconds++;
+        }
+    }
+}
+
+// Catches the uptime up on 10 us ticks the interrupt never saw, e.g. while
+// the CPU was stalled by a flash write
+void Util_AdvanceUptime(uint16_t ticks)
+{
+    uint16_t milliseconds;
+
+    INTCONbits.GIEL = 0;
+    uptimeTicksMicroSeconds += (uint32_t)ticks * 10;
+    ticks += uptimeTicksInMillisecond;
+    uptimeTicksInMillisecond = ticks % 100;
+    milliseconds = ticks / 100;
+    uptimeMilliseconds += milliseconds;
+    milliseconds += uptimeMillisecondsInSecond;
+    uptimeMillisecondsInSecond = milliseconds % 1000;
+    uptimeSeconds += milliseconds / 1000;
+    INTCONbits.GIEL = 1;
+}
+
+// The tick can land part way through reading any of the uptimes, so keep
+// reading until two reads agree
 uint32_t Util_GetMicrosecondUptime(void)
 {
-    return uptimeTicksMicroSeconds;
+    uint32_t uptime;
+
+    do
+    {
+        uptime = uptimeTicksMicroSeconds;
+    }
+    while (uptime != uptimeTicksMicroSeconds);
+
+    return uptime;
+}
+
+uint32_t Util_GetMillisecondUptime(void)
+{
+    uint32_t uptime;
+
+    do
+    {
+        uptime = uptimeMilliseconds;
+    }
+    while (uptime != uptimeMilliseconds);
+
+    return uptime;
+}
+
+uint32_t Util_GetSecondUptime(void)
+{
+    uint32_t uptime;
+
+    do
+    {
+        uptime = uptimeSeconds;
+    }
+    while (uptime != uptimeSeconds);
+
+    return uptime;
+}
+
+uint32_t Util_GetPulseCount(void)
+{
+    uint32_t count;
+
+    // The high priority interrupt can change it part way through a read,
+    // even from the low priority one
+    do
+    {
+        count = pulseCount;
+    }
+    while (count != pulseCount);
+
+    return count;
 }
 
 void Util_WaitMicrosecond(uint16_t microseconds)
@@ -171,10 +370,10 @@ void Util_WaitMicrosecond(uint16_t microseconds)
     uint32_t startTime;
     uint32_t currentTime;
 
-    startTime = uptimeTicksMicroSeconds;
+    startTime = Util_GetMicrosecondUptime();
     do
     {
-        currentTime = uptimeTicksMicroSeconds;
+        currentTime = Util_GetMicrosecondUptime();
     }
     while ((currentTime - startTime) < microseconds);
 }
\ No newline at end of file
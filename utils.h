@@ -29,13 +29,34 @@
 
 #define MICROSECONDS_IN_SECONDS         (1000000)
 #define MICROSECONDS_IN_MILLISECONDS    (1000)
+// Timer3 runs at 1.5 MHz, so CCPR1 tops out at 65535 ticks
+#define MAX_COMPARE_PERIOD_US           (43690)
+// scanf only ever reads one int off the console, longer lines are cut short
+#ifndef SCANF_BUFFER_LENGTH
+#define SCANF_BUFFER_LENGTH             (16)
+#endif
 
-extern uint32_t uptimeTicksMicroSeconds;
+extern volatile uint32_t uptimeTicksMicroSeconds;
+extern volatile uint32_t uptimeMilliseconds;
+extern volatile uint32_t uptimeSeconds;
+extern volatile uint32_t pulseCount;
+extern volatile uint16_t pulseLatencyWorst;
 
 void Util_GeneratePulseRB0(void);
+uint16_t Util_VanDerCorput(uint32_t index);
+uint16_t Util_MicrosecondsToTicks(uint16_t microseconds);
 void Util_SetNewCompareValue(uint16_t desiredPeriod);
+void Util_SetCompareTicks(uint16_t ticks);
+void Util_StageCompareValue(uint16_t desiredPeriod);
+void Util_ApplyStagedCompareValue(void);
 void Util_ToggleRB0(void);
+uint16_t Util_GetTicksToNextMatch(void);
+void Util_UptimeTickIsr(void);
+void Util_AdvanceUptime(uint16_t ticks);
 uint32_t Util_GetMicrosecondUptime(void);
+uint32_t Util_GetMillisecondUptime(void);
+uint32_t Util_GetSecondUptime(void);
+uint32_t Util_GetPulseCount(void);
 void Util_WaitMicrosecond(uint16_t microseconds);
 
 #endif // UTILS_H
\ No newline at end of file